@@ -71,14 +71,47 @@ extra_compile_args = []
 debug_variable_name = 'FASTFILE_DEBUG'
 regex_variable_name = 'FASTFILE_REGEX'
 getline_variable_name = 'FASTFILE_GETLINE'
+readahead_variable_name = 'FASTFILE_READAHEAD'
+regexthreads_variable_name = 'FASTFILE_REGEXTHREADS'
+regexbuffer_variable_name = 'FASTFILE_REGEXBUFFER'
 trimutf8_variable_name = 'FASTFILE_TRIMUFT8'
 
 debug_variable_value = int( os.environ.get( debug_variable_name, 0 ) )
 regex_variable_value = int( os.environ.get( regex_variable_name, 0 ) )
 getline_variable_value = int( os.environ.get( getline_variable_name, 0 ) )
+readahead_variable_value = int( os.environ.get( readahead_variable_name, 0 ) )
+regexthreads_variable_value = int( os.environ.get( regexthreads_variable_name, 0 ) )
+regexbuffer_variable_value = int( os.environ.get( regexbuffer_variable_name, 0 ) )
 trimutf8_variable_value = int( os.environ.get( trimutf8_variable_name, 1 ) )
 
+# every regex engine library found is compiled into the module, then, it can be picked with the
+# `engine` constructor keyword, while `FASTFILE_REGEX` only picks the default engine
+regex_libraries = [
+    ( 2, 'pcre2-8', 'pcre2.h', 'FASTFILE_WITH_PCRE2' ),
+    ( 3, 're2', 're2/re2.h', 'FASTFILE_WITH_RE2' ),
+    ( 4, 'hs', 'hs/hs.h', 'FASTFILE_WITH_HYPERSCAN' ),
+]
+
+# the compressed files are decompressed by the libraries found, see source/fastfiledecompressor.h
+compression_libraries = [
+    ( 'z', 'zlib.h', 'FASTFILE_WITH_ZLIB' ),
+    ( 'zstd', 'zstd.h', 'FASTFILE_WITH_ZSTD' ),
+    ( 'lz4', 'lz4frame.h', 'FASTFILE_WITH_LZ4' ),
+]
+
 class build_ext_compiler_check(build_ext):
+    def has_library(self, library, header):
+        include_dirs = self.compiler.include_dirs + [ '/usr/include', '/usr/local/include' ]
+        library_dirs = self.compiler.library_dirs + [ '/usr/lib', '/usr/lib64', '/usr/local/lib' ]
+
+        multiarch = get_config_vars().get( 'MULTIARCH' )
+        if multiarch:
+            library_dirs.append( os.path.join( '/usr/lib', multiarch ) )
+
+        if not any( os.path.exists( os.path.join( directory, header ) ) for directory in include_dirs ):
+            return False
+        return self.compiler.find_library_file( library_dirs, library ) is not None
+
     def build_extensions(self):
         compiler = self.compiler.compiler_type
 
@@ -109,19 +142,28 @@ class build_ext_compiler_check(build_ext):
 
                     extension.extra_compile_args.append( '-std=c++11' )
                     extension.extra_compile_args.append( '-fstack-protector-all' )
+                    extension.extra_compile_args.append( '-pthread' )
 
                     extension.extra_link_args.append( '-std=c++11' )
                     extension.extra_link_args.append( '-fstack-protector-all' )
+                    extension.extra_link_args.append( '-pthread' )
+
+                for variable_value, library, header, macro in regex_libraries:
+
+                    if regex_variable_value == variable_value or self.has_library( library, header ):
+                        sys.stderr.write( "Using fastfilepackage regex library '%s'!\n" % library )
+                        extension.define_macros.append( (macro, 1) )
+                        extension.libraries.append( library )
 
-                if regex_variable_value == 2:
-                        extension.libraries.append( 'pcre2-8' )
+                        if library == 'hs':
+                            extension.include_dirs.append( '/usr/include/hs' )
 
-                if regex_variable_value == 3:
-                        extension.libraries.append( 're2' )
+                for library, header, macro in compression_libraries:
 
-                if regex_variable_value == 4:
-                        extension.libraries.append( 'hs' )
-                        extension.include_dirs.append( '/usr/include/hs' )
+                    if self.has_library( library, header ):
+                        sys.stderr.write( "Using fastfilepackage compression library '%s'!\n" % library )
+                        extension.define_macros.append( (macro, 1) )
+                        extension.libraries.append( library )
 
         super().build_extensions()
 
@@ -161,6 +203,21 @@ if getline_variable_value:
     define_macros.append( (getline_variable_name, getline_variable_value) )
 
 
+if readahead_variable_value:
+    sys.stderr.write( "Using fastfilepackage '%s=%s' environment variable!\n" % ( readahead_variable_name, readahead_variable_value ) )
+    define_macros.append( (readahead_variable_name, readahead_variable_value) )
+
+
+if regexthreads_variable_value:
+    sys.stderr.write( "Using fastfilepackage '%s=%s' environment variable!\n" % ( regexthreads_variable_name, regexthreads_variable_value ) )
+    define_macros.append( (regexthreads_variable_name, regexthreads_variable_value) )
+
+
+if regexbuffer_variable_value:
+    sys.stderr.write( "Using fastfilepackage '%s=%s' environment variable!\n" % ( regexbuffer_variable_name, regexbuffer_variable_value ) )
+    define_macros.append( (regexbuffer_variable_name, regexbuffer_variable_value) )
+
+
 if trimutf8_variable_value is not None:
     sys.stderr.write( "Using fastfilepackage '%s=%s' environment variable!\n" % ( trimutf8_variable_name, trimutf8_variable_value ) )
     define_macros.append( (trimutf8_variable_name, trimutf8_variable_value) )
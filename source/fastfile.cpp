@@ -2,40 +2,34 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include "debugger.h"
+#include "fastfilesimd.h"
+#include "fastfileutf8.h"
+#include "fastfilelinecache.h"
+#include "fastfilelineindex.h"
+#include "fastfilereverse.h"
+#include "fastfilefollow.h"
 
 #include <cstdio>
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <fstream>
-#include <deque>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cstring>
 
-#define FASTFILE_GETLINE_DISABLED     0
-#define FASTFILE_GETLINE_STDGETLINE   1
-#define FASTFILE_GETLINE_POSIXGETLINE 2
-
-#if !defined(FASTFILE_GETLINE)
-    #define FASTFILE_GETLINE 0
-#endif
-
-// https://stackoverflow.com/questions/56260096/how-to-improve-python-c-extensions-file-line-reading
-// https://stackoverflow.com/questions/17237545/preprocessor-check-if-multiple-defines-are-not-defined
-#if !defined(__unix__)
-    #if FASTFILE_GETLINE == FASTFILE_GETLINE_POSIXGETLINE
-        #undef FASTFILE_GETLINE
-        #define FASTFILE_GETLINE 0
-    #endif
-#endif
-
-
-#define FASTFILE_UTF8CHARACTER_TRIMMING
-#define FASTFILE_TRIMUFT8_DISABLED      0
-#define FASTFILE_TRIMUFT8_PRINTABLEONLY 1
 
 #if !defined(FASTFILE_TRIMUFT8)
     #define FASTFILE_TRIMUFT8 FASTFILE_TRIMUFT8_PRINTABLEONLY
 #endif
 
+#if FASTFILE_TRIMUFT8 < 0 || FASTFILE_TRIMUFT8 > 2
+    #error The FASTFILE_TRIMUFT8 define must to be between 0 and 2!
+    #undef FASTFILE_TRIMUFT8
+    #define FASTFILE_TRIMUFT8 0
+#endif
+
 #if FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_DISABLED
     #define FASTFILE_ISTRIM_UFT8_DISABLED(value) value
     #define FASTFILE_ISTRIM_UFT8_ENABLED(value)
@@ -46,121 +40,48 @@
 
 #endif
 
-#define FASTFILE_NEWLINETRIMMING \
-    --charsread; \
-    if( readline[charsread] == '\n' ) { \
-        readline[charsread] = '\0'; \
-    } \
-    else { \
-        ++charsread; \
-        readline[charsread] = '\0'; \
-    }
-
-#if FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_PRINTABLEONLY
-    #undef FASTFILE_UTF8CHARACTER_TRIMMING
-
-    // https://stackoverflow.com/questions/56604934/how-to-remove-the-uft8-character-from-a-char-string
-    #define FASTFILE_UTF8CHARACTER_TRIMMING \
-        lineend = readline + charsread; \
-        destination = readline; \
-        for( source = readline; source != lineend; ++source ) \
-        { \
-            fixedchar = static_cast<unsigned int>( *source ); \
-            if( 31 < fixedchar && fixedchar < 128 ) { \
-                *destination = *source; \
-                ++destination; \
-            } \
-            else { \
-                --charsread; \
-            } \
-        }
+#if !defined(FASTFILE_REGEX)
+    #define FASTFILE_REGEX 0
 #endif
 
+#if !defined(FASTFILE_REGEXBUFFER)
+    #define FASTFILE_REGEXBUFFER 0
+#endif
 
-#define FASTFILE_REGEX_DISABLED  0
-#define FASTFILE_REGEX_C_ENGINE  1
-#define FASTFILE_REGEX_PCRE2     2
-#define FASTFILE_REGEX_RE2       3
-#define FASTFILE_REGEX_HYPERSCAN 4
+#include "fastfilebackends.h"
+#include "fastfileengines.h"
 
-#if !defined(FASTFILE_REGEX) || FASTFILE_GETLINE != 2
-    #undef FASTFILE_REGEX
-    #define FASTFILE_REGEX 0
 
-#else
-    #define STANDARDERRORMESSAGE \
-            std::cerr << "ERROR: FastFile match failed the following returncode='" \
-                    << returncode << "' file='" \
-                    << filepath <<  "' line='" << readline << "'!" << std::endl; \
-
-    #define STANDARDERRORMESSAGEDETAILS \
-            LOG( 1, "regexresult: %s readline %p charsread %d '%s'", returncode, readline, charsread, readline );
-
-    #if FASTFILE_REGEX == FASTFILE_REGEX_C_ENGINE
-        #include <regex.h>
-        #define REGEXMATCHFUNCTION \
-                ( ( returncode = regexec( &monsterregex, readline, 0, NULL, 0 ) ) != REG_NOMATCH )
-
-        #define REGEXERRORFUNCTION \
-                STANDARDERRORMESSAGEDETAILS
-
-    #elif FASTFILE_REGEX == FASTFILE_REGEX_PCRE2
-        #define PCRE2_CODE_UNIT_WIDTH 8
-        #include <pcre2.h>
-        #define REGEXMATCHFUNCTION \
-                ( ( returncode = pcre2_match( monsterregex, reinterpret_cast<PCRE2_SPTR>( readline ), \
-                        PCRE2_ZERO_TERMINATED, 0, PCRE2_NO_UTF_CHECK, unused_match_data, NULL ) ) > -1 )
-
-        #define REGEXERRORFUNCTION \
-                if( returncode < -2 ) { \
-                    STANDARDERRORMESSAGE \
-                } \
-                STANDARDERRORMESSAGEDETAILS
-
-    #elif FASTFILE_REGEX == FASTFILE_REGEX_RE2
-        #include <re2/re2.h>
-        #define REGEXMATCHFUNCTION \
-                ( returncode = RE2::PartialMatch( readline, *monsterregex ) )
-
-        #define REGEXERRORFUNCTION \
-                STANDARDERRORMESSAGEDETAILS
-
-    #elif FASTFILE_REGEX == FASTFILE_REGEX_HYPERSCAN
-        #include <hs.h>
-        #define REGEXMATCHFUNCTION \
-                ( ( returncode = hs_scan( \
-                        monsterregex, readline, charsread, 0, scratchspace, null_onEvent, NULL \
-                        ) ) == HS_SCAN_TERMINATED )
-
-        #define REGEXERRORFUNCTION \
-                if( returncode < 0 ) { \
-                    STANDARDERRORMESSAGE \
-                } \
-                STANDARDERRORMESSAGEDETAILS
-
-        static int HS_CDECL null_onEvent(
-                unsigned id,
-                unsigned long long from,
-                unsigned long long to,
-                unsigned flags,
-                void *ctxt)
-        {
-            return 1;
-        }
-    #endif
+// The backend and the regex engine used when the constructor keywords do not pick them, all the
+// others are also compiled into the module, see fastfile_create()
+#if !defined(FASTFILE_GETLINE)
+    #define FASTFILE_GETLINE 0
+#endif
+
+#if FASTFILE_GETLINE < 0 || FASTFILE_GETLINE > 3
+    #error The FASTFILE_GETLINE define must to be between 0 and 3!
+    #undef FASTFILE_GETLINE
+    #define FASTFILE_GETLINE 0
 #endif
 
+// https://stackoverflow.com/questions/56260096/how-to-improve-python-c-extensions-file-line-reading
+// https://stackoverflow.com/questions/17237545/preprocessor-check-if-multiple-defines-are-not-defined
+#if !defined(__unix__)
+    #if FASTFILE_GETLINE == FASTFILE_GETLINE_POSIXGETLINE || FASTFILE_GETLINE == FASTFILE_GETLINE_MEMORYMAP
+        #undef FASTFILE_GETLINE
+        #define FASTFILE_GETLINE 0
+    #endif
+#endif
 
-#if FASTFILE_TRIMUFT8 < 0 || FASTFILE_TRIMUFT8 > 1
-    #error The FASTFILE_TRIMUFT8 define must to be between 0 and 1!
-    #undef FASTFILE_TRIMUFT8
-    #define FASTFILE_TRIMUFT8 0
+#if !defined(FASTFILE_READAHEAD) || FASTFILE_GETLINE != FASTFILE_GETLINE_POSIXGETLINE
+    #undef FASTFILE_READAHEAD
+    #define FASTFILE_READAHEAD 0
 #endif
 
-#if FASTFILE_GETLINE < 0 || FASTFILE_GETLINE > 2
-    #error The FASTFILE_GETLINE define must to be between 0 and 2!
-    #undef FASTFILE_GETLINE
-    #define FASTFILE_GETLINE 0
+#if FASTFILE_READAHEAD
+    #define FASTFILE_DEFAULTBACKEND FASTFILE_GETLINE_READAHEAD
+#else
+    #define FASTFILE_DEFAULTBACKEND FASTFILE_GETLINE
 #endif
 
 #if FASTFILE_REGEX < 0 || FASTFILE_REGEX > 4
@@ -169,255 +90,173 @@
     #define FASTFILE_REGEX 0
 #endif
 
+#if FASTFILE_REGEX == FASTFILE_REGEX_C_ENGINE && !FASTFILE_WITH_C_ENGINE
+    #define FASTFILE_DEFAULTENGINE FASTFILE_REGEX_DISABLED
+#else
+    #define FASTFILE_DEFAULTENGINE FASTFILE_REGEX
+#endif
 
-struct FastFile {
-    const char* filepath;
 
-    PyObject* emtpycacheobject;
-    std::deque<PyObject*> linecache;
+// The native backends read several lines at once without holding the GIL, then, other Python
+// threads keep running while this one waits for the disk or runs the regex over these lines
+#define FASTFILE_LINEBATCH_LINES 1024
+#define FASTFILE_LINEBATCH_SIZE  262144
 
-    bool hasclosed;
-    bool hasfinished;
-    bool enableregex;
+// Matches each batch of lines with this many threads, instead of matching them one by one while
+// reading them, the lines still come out in the file order
+#if !defined(FASTFILE_REGEXTHREADS)
+    #define FASTFILE_REGEXTHREADS 0
+#endif
 
-    char* readline;
-    size_t linebuffersize;
+#if FASTFILE_REGEXTHREADS < 0
+    #error The FASTFILE_REGEXTHREADS define must to be 0 or greater!
+    #undef FASTFILE_REGEXTHREADS
+    #define FASTFILE_REGEXTHREADS 0
+#endif
 
-#if FASTFILE_GETLINE == FASTFILE_GETLINE_DISABLED
-    PyObject* iomodule;
-    PyObject* openfile;
-    PyObject* fileiterator;
-#else
+#if FASTFILE_REGEXTHREADS
+    #include "fastfileworkers.h"
 
-    #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-        bool getnewline;
-        bool hasinitializedmonsterregex;
+    // give each thread enough lines to make up for waking it up
+    #undef FASTFILE_LINEBATCH_LINES
+    #undef FASTFILE_LINEBATCH_SIZE
+    #define FASTFILE_LINEBATCH_LINES ( 4096 * FASTFILE_REGEXTHREADS )
+    #define FASTFILE_LINEBATCH_SIZE  ( 524288 * FASTFILE_REGEXTHREADS )
+#endif
 
-        #if FASTFILE_REGEX == FASTFILE_REGEX_C_ENGINE
-            regex_t monsterregex;
 
-        #elif FASTFILE_REGEX == FASTFILE_REGEX_PCRE2
-            pcre2_code* monsterregex;
-            pcre2_match_data* unused_match_data;
+// Returns the characters of a line object, or the characters of all its fields plus their delimiters,
+// where the numbers and the missing fields count as empty fields
+static inline Py_ssize_t fastfile_objectlength(PyObject* pythonobject) {
+    if( PyUnicode_Check( pythonobject ) ) {
+        return PyUnicode_GET_LENGTH( pythonobject );
+    }
 
-        #elif FASTFILE_REGEX == FASTFILE_REGEX_RE2
-            RE2* monsterregex;
-            RE2::Options myglobaloptions;
+    if( PyTuple_Check( pythonobject ) ) {
+        Py_ssize_t length = PyTuple_GET_SIZE( pythonobject );
 
-        #elif FASTFILE_REGEX == FASTFILE_REGEX_HYPERSCAN
-            hs_scratch_t *scratchspace = NULL;
-            hs_database_t *monsterregex;
-        #endif
-    #endif
+        for( Py_ssize_t index = 0; index < PyTuple_GET_SIZE( pythonobject ); ++index ) {
+            PyObject* field = PyTuple_GET_ITEM( pythonobject, index );
+            length += PyUnicode_Check( field ) || PyBytes_Check( field ) ? fastfile_objectlength( field ) : 0;
+        }
+        return length - 1;
+    }
+    return PyObject_Length( pythonobject );
+}
+
+/**
+ * Everything shared by all the backends, i.e., the lines cache seen by Python. Each backend only
+ * implements _getline() pushing the next line bytes into `linecache`, and FastFileCore matches the
+ * lines with the regex engine it was specialized with.
+ */
+struct FastFile {
+    std::string filepath;
 
-    #if FASTFILE_GETLINE == FASTFILE_GETLINE_POSIXGETLINE
-        FILE* cfilestream;
+    PyObject* emtpycacheobject;
+    FastFileLineCache linecache;
+    FastFileLineIndex lineindex;
 
-    #elif FASTFILE_GETLINE == FASTFILE_GETLINE_STDGETLINE
-        std::ifstream fileifstream;
-    #endif
-#endif
+    bool hasclosed;
+    bool hasfinished;
+    bool enableregex;
+    bool getnewline;
+    bool isbuiltins;
+    bool isseekable;
+    bool isreversed;
+    bool isfollowing;
+
+    // The control character kept by the FASTFILE_TRIMUFT8 trimming, i.e., the fields delimiter
+    int keptcharacter;
+
+    // While one thread is reading the file without holding the GIL, any other thread using this
+    // same object waits for it on `readingmutex`, also without holding the GIL
+    bool isreading;
+    std::mutex readingmutex;
 
     long long int linecount;
     long long int currentline;
 
     // https://stackoverflow.com/questions/25167543/how-can-i-get-exception-information-after-a-call-to-pyrun-string-returns-nu
-    FastFile(const char* filepath, const char* rawregex) :
+    FastFile(const char* filepath, const FastFileLineOptions& lineoptions) :
                 filepath(filepath),
                 hasclosed(false),
                 hasfinished(false),
                 enableregex(false),
-
-            #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
                 getnewline(false),
-                hasinitializedmonsterregex(false),
-            #endif
+                isbuiltins(false),
+                isseekable(false),
+                isreversed(false),
+                isfollowing(lineoptions.follow),
+                keptcharacter(lineoptions.keptcharacter),
+                isreading(false),
                 linecount(0),
                 currentline(-1)
     {
-        LOG( 1, "Constructor with:\nFASTFILE_GETLINE=%s\nFASTFILE_REGEX=%s\nFASTFILE_TRIMUFT8=%s\nfilepath=%s\nrawregex=%s",
-                FASTFILE_GETLINE, FASTFILE_REGEX, FASTFILE_TRIMUFT8, filepath, rawregex );
-
-        if( rawregex && strlen(rawregex) ) {
-            enableregex = true;
-            LOG( 1, "Setting enableregex to true" );
-        }
+        linecache.setoptions( lineoptions );
+        linecache.isascii = FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_PRINTABLEONLY;
+        linecache.isutf8 = FASTFILE_TRIMUFT8 != FASTFILE_TRIMUFT8_DISABLED;
+        lineindex.setup( filepath, lineoptions.indexfile );
+        emtpycacheobject = fastfile_emptyobject( lineoptions.mode );
 
-        emtpycacheobject = PyUnicode_DecodeUTF8( "", 0, "ignore" );
         if( emtpycacheobject == NULL ) {
             std::cerr << "ERROR: FastFile failed to create the empty string object (and open the file '"
                     << filepath << "')!" << std::endl;
             PyErr_PrintEx(100);
-            return;
-        }
-
-        linebuffersize = 131072;
-        readline = (char*) malloc( linebuffersize );
-
-        if( readline == NULL ) {
-            std::cerr << "ERROR: FastFile failed to alocate internal line buffer for readline '"
-                    << filepath << "'!" << std::endl;
-            return;
+            hasfinished = true;
         }
+    }
 
-    #if FASTFILE_GETLINE == FASTFILE_GETLINE_DISABLED
-        // https://stackoverflow.com/questions/47054623/using-python3-c-api-to-add-to-builtins
-        iomodule = PyImport_ImportModule( "builtins" );
-
-        if( iomodule == NULL ) {
-            std::cerr << "ERROR: FastFile failed to import the io module (and open the file '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
+    // The derived destructors must call close() by themselves, as _close() cannot reach them here
+    virtual ~FastFile() {
+        LOG( 1, "Destructor linecount %llu currentline %llu hasclosed %d", linecount, currentline, hasclosed );
+        if( hasclosed ) {
             return;
         }
-        PyObject* openfunction = PyObject_GetAttrString( iomodule, "open" );
+        this->close();
+    }
 
-        if( openfunction == NULL ) {
-            std::cerr << "ERROR: FastFile failed get the io module open function (and open the file '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
-        }
-        // https://stackoverflow.com/questions/56482802/c-python-api-extensions-is-ignoring-openerrors-ignore-and-keeps-throwing-the
-        openfile = PyObject_CallFunction( openfunction, "ssiss", filepath, "r", -1, "UTF8", "ignore" );
+    // Reads the next line into `linecache`, returning false on the file end
+    virtual bool _getline() = 0;
 
-        if( openfile == NULL ) {
-            std::cerr << "ERROR: FastFile failed to open the file'"
-                    << filepath << "'!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
-        }
-        PyObject* iterfunction = PyObject_GetAttrString( openfile, "__iter__" );
-        Py_DECREF( openfunction );
+    // Matches a line already on `linecache`, only called when there is a regex
+    virtual bool _matchline(const char* readline, size_t charsread) {
+        return true;
+    }
 
-        if( iterfunction == NULL ) {
-            std::cerr << "ERROR: FastFile failed get the io module iterator function (and open the file '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
-        }
-        PyObject* openiteratorobject = PyObject_CallObject( iterfunction, NULL );
-        Py_DECREF( iterfunction );
+    virtual void _patternids(const char* readline, size_t charsread, std::vector<int>& matchedids) {
+    }
 
-        if( openiteratorobject == NULL ) {
-            std::cerr << "ERROR: FastFile failed get the io module iterator object (and open the file '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
-        }
-        fileiterator = PyObject_GetAttrString( openfile, "__next__" );
-        Py_DECREF( openiteratorobject );
+    // Closes the file and frees everything the backend created
+    virtual void _close() {
+    }
 
-        if( fileiterator == NULL ) {
-            std::cerr << "ERROR: FastFile failed get the io module iterator object (and open the file '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
+    // Makes the UTF-8 trimming keep the `character` control character, which is only possible
+    // before reading any line, as the lines are trimmed while they are read
+    virtual bool _keepcharacter(int character) {
+        if( linecount || linecache.size() || hasfinished ) {
+            return false;
         }
-    #else
-
-        #if FASTFILE_GETLINE == FASTFILE_GETLINE_POSIXGETLINE
-            cfilestream = fopen( filepath, "r" );
-            if( cfilestream == NULL ) {
-                std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
-                return;
-            }
-
-            #if FASTFILE_REGEX == FASTFILE_REGEX_C_ENGINE
-                int rawresultregex = regcomp( &monsterregex, rawregex, REG_NOSUB | REG_EXTENDED );
-
-                if( rawresultregex ) {
-                    std::cerr << "ERROR: FastFile failed to compile rawregex for '"
-                            << filepath << " & " << rawregex << ", error==" << rawresultregex << "'!" << std::endl;
-                    return;
-                }
-                else {
-                    hasinitializedmonsterregex = true;
-                }
-
-            #elif FASTFILE_REGEX == FASTFILE_REGEX_PCRE2
-                int errorcode;
-                PCRE2_SIZE erroffset;
-
-                unused_match_data = pcre2_match_data_create( 1, NULL );
-                monsterregex = pcre2_compile( reinterpret_cast<PCRE2_SPTR>( rawregex ),
-                        PCRE2_ZERO_TERMINATED, PCRE2_UTF, &errorcode, &erroffset, NULL );
-
-                if( monsterregex == NULL ) {
-                    hasinitializedmonsterregex = true;
-                    PCRE2_UCHAR8 errorbuffer[1024];
-                    int errormessageresult = pcre2_get_error_message( errorcode, errorbuffer, sizeof( errorbuffer ) );
-
-                    std::cerr << "ERROR: FastFile failed to compile rawregex for '"
-                            << filepath << " & " << rawregex;
-
-                    if( errormessageresult < 1 ) {
-                            std::cerr << ", error==" << errorcode;
-                    }
-                    else {
-                        std::cerr << ", error==" << errorcode << ", " << errorbuffer;
-                    }
-
-                    std::cerr << ", on position==" << erroffset << "'!" << std::endl;
-                    return;
-                }
-
-            #elif FASTFILE_REGEX == FASTFILE_REGEX_RE2
-                // myglobaloptions.set_posix_syntax(true);
-                monsterregex = new RE2(rawregex, myglobaloptions);
-
-                if( monsterregex->ok() ) {
-                    hasinitializedmonsterregex = true;
-                }
-                else {
-                    std::cerr << "ERROR: FastFile failed to compile rawregex for '"
-                            << filepath << " & " << rawregex
-                            << ", error==" << monsterregex->error() << "'!" << std::endl;
-                    return;
-                }
-
-            #elif FASTFILE_REGEX == FASTFILE_REGEX_HYPERSCAN
-                hs_compile_error_t *compile_err;
-
-                if( hs_compile( rawregex, HS_FLAG_SINGLEMATCH | HS_FLAG_DOTALL, HS_MODE_BLOCK, NULL, &monsterregex,
-                               &compile_err ) != HS_SUCCESS )
-                {
-                    std::cerr << "ERROR: FastFile failed to compile rawregex for '"
-                            << filepath << " & " << rawregex
-                            << ", error==" << compile_err->message << "'!" << std::endl;
-                    hs_free_compile_error( compile_err );
-                    return;
-                }
-
-                if( hs_alloc_scratch( monsterregex, &scratchspace ) != HS_SUCCESS ) {
-                    std::cerr << "ERROR: FastFile failed to allocate scratch space for '"
-                            << filepath << " & " << rawregex << "'!" << std::endl;
-                    return;
-                }
-
-                hasinitializedmonsterregex = true;
-            #endif
 
-        #elif FASTFILE_GETLINE == FASTFILE_GETLINE_STDGETLINE
-            fileifstream.open( filepath );
+        keptcharacter = character;
+        return true;
+    }
 
-            if( fileifstream.fail() ) {
-                std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
-                return;
-            }
-        #endif
-    #endif
+    // Makes this object return the file lines from the last one to the first one, it must be called
+    // before reading any line
+    virtual bool reverse() {
+        return false;
     }
 
-    ~FastFile() {
-        LOG( 1, "Destructor linecount %llu currentline %llu hasclosed %d", linecount, currentline, hasclosed );
-        if( hasclosed ) {
-            return;
-        }
-        this->close();
+    // Moves the backend to the line starting at `offset`, then, reads and drops `skiplines` lines.
+    // It is called without holding the GIL.
+    virtual bool _seek(uint64_t offset, uint64_t skiplines) {
+        return false;
     }
 
     void close() {
+        // a thread following the file stops waiting for it, instead of close() waiting forever
+        isfollowing = false;
+        _waitreading();
         LOG( 1, "linecount %llu currentline %llu hasclosed %d", linecount, currentline, hasclosed );
         if( hasclosed ) {
             return;
@@ -426,233 +265,514 @@ struct FastFile {
         hasclosed = true;
         Py_XDECREF( emtpycacheobject );
 
-        for( PyObject* pyobject : linecache ) {
-            Py_DECREF( pyobject );
-        }
-
-        if( readline ) {
-            free( readline );
-            readline = NULL;
-        }
-
-    #if FASTFILE_GETLINE == FASTFILE_GETLINE_DISABLED
-        PyObject* closefunction = PyObject_GetAttrString( openfile, "close" );
-
-        if( closefunction == NULL ) {
-            std::cerr << "ERROR: FastFile failed get the close file function for '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
-        }
-
-        PyObject* closefileresult = PyObject_CallObject( closefunction, NULL );
-        Py_DECREF( closefunction );
-
-        if( closefileresult == NULL ) {
-            std::cerr << "ERROR: FastFile failed close open file '"
-                    << filepath << "')!" << std::endl;
-            PyErr_PrintEx(100);
-            return;
-        }
-        Py_DECREF( closefileresult );
-
-        Py_XDECREF( iomodule );
-        Py_XDECREF( openfile );
-        Py_XDECREF( fileiterator );
-
-    #else
-
-        #if FASTFILE_GETLINE == FASTFILE_GETLINE_POSIXGETLINE
-            if( cfilestream != NULL ) {
-                fclose( cfilestream );
-                cfilestream = NULL;
-            }
-        #elif FASTFILE_GETLINE == FASTFILE_GETLINE_STDGETLINE
-            if( fileifstream.is_open() ) {
-                fileifstream.close();
-            }
-        #endif
-
-        #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-            if( hasinitializedmonsterregex ) {
-                hasinitializedmonsterregex = false;
-
-            #if FASTFILE_REGEX == FASTFILE_REGEX_C_ENGINE
-                regfree( &monsterregex );
-
-            #elif FASTFILE_REGEX == FASTFILE_REGEX_PCRE2
-                pcre2_code_free( monsterregex );
-
-            #elif FASTFILE_REGEX == FASTFILE_REGEX_RE2
-                delete monsterregex;
-
-            #elif FASTFILE_REGEX == FASTFILE_REGEX_HYPERSCAN
-                hs_free_scratch( scratchspace );
-                hs_free_database( monsterregex );
-            #endif
-            }
-        #endif
-    #endif
+        lineindex.stop();
+        linecache.clear();
+        _close();
     }
 
     void resetlines(int linetoreset=0) {
+        _waitreading();
         currentline = linetoreset;
     }
 
     std::string getlines(unsigned int linestoget) {
+        _waitreading();
         std::stringstream stream;
 
         if( linestoget ) {
-            Py_ssize_t linesize;
+            size_t linesize;
             const char* cppline;
             unsigned int current = 1;
 
-            for( PyObject* linepy : linecache ) {
+            for( size_t index = 0; index < linecache.size(); ++index ) {
                 ++current;
-                cppline = PyUnicode_AsUTF8AndSize( linepy, &linesize );
-                stream << std::string{cppline};
+                cppline = linecache.line( index );
+                linesize = linecache.linesize( index );
+                stream << std::string( cppline, linesize );
 
                 if( linestoget < current ) {
-                    if( cppline[linesize-1] == '\n' ) {
+                    if( linesize && cppline[linesize-1] == '\n' ) {
                         stream.seekp( -1, std::ios_base::end );
                         stream << " ";
                     }
                     break;
                 }
-            // lines comming will not have a ending new line character
-            #if FASTFILE_GETLINE == FASTFILE_GETLINE_DISABLED
-                else {
+                // lines comming will not have a ending new line character
+                else if( isbuiltins ) {
                     stream << '\n';
                 }
-            #endif
             }
         }
         return stream.str();
     }
 
-    // https://stackoverflow.com/questions/56260096/how-to-improve-python-c-extensions-file-line-reading
-    bool _getline() {
-        // Fix StopIteration being raised multiple times because _getlines is called multiple times
-        if( hasfinished ) { return false; }
-        ssize_t charsread;
+    // Must be called while holding the GIL, right before releasing it to read the file
+    void _beginreading() {
+        isreading = true;
+        readingmutex.lock();
+    }
 
-    #if FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_PRINTABLEONLY
-        char* destination;
-        const char* source;
-        const char* lineend;
-        unsigned int fixedchar;
-    #endif
+    // Must be called right after taking back the GIL
+    void _endreading() {
+        isreading = false;
+        readingmutex.unlock();
+    }
+
+    // Called by every method which touches the lines, it waits without holding the GIL while
+    // another thread is reading this same file without holding the GIL
+    void _waitreading() {
+        while( isreading ) {
+            Py_BEGIN_ALLOW_THREADS
+            readingmutex.lock();
+            readingmutex.unlock();
+            Py_END_ALLOW_THREADS
+        }
+    }
 
-    #if FASTFILE_GETLINE == FASTFILE_GETLINE_POSIXGETLINE
+    // Returns a list with the indexes of the patterns matching the current line, i.e., the last line
+    // returned by the iterator. The lines are only filtered by any of the patterns, then, the current
+    // line is matched again by each pattern, only when this is called.
+    PyObject* patternids() {
+        _waitreading();
+        PyObject* patternidslist = PyList_New( 0 );
 
-        #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-            int returncode;
-        #endif
+        if( patternidslist == NULL ) {
+            return NULL;
+        }
 
-        while( true ) {
-            if( ( charsread = getline( &readline, &linebuffersize, cfilestream ) ) != -1 )
-            {
-                FASTFILE_UTF8CHARACTER_TRIMMING
-                FASTFILE_ISTRIM_UFT8_ENABLED( FASTFILE_NEWLINETRIMMING )
-
-            #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-                if( !getnewline || REGEXMATCHFUNCTION )
-                {
-                    getnewline = false;
-            #endif
-                    FASTFILE_ISTRIM_UFT8_DISABLED( FASTFILE_NEWLINETRIMMING )
-                    ++linecount;
-
-                    PyObject* pythonobject = PyUnicode_DecodeUTF8( readline, charsread, "ignore" );
-                    linecache.push_back( pythonobject );
-
-                    // Py_XINCREF( emtpycacheobject );
-                    // linecache.push_back( emtpycacheobject );
-                    LOG( 1, "linecount %llu currentline %llu readline '%p' '%s'", linecount, currentline, pythonobject, readline );
-                    return true;
-
-            #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-                }
+        if( !enableregex || linecache.empty() ) {
+            return patternidslist;
+        }
 
-                REGEXERRORFUNCTION
-            #endif
-            }
-            else {
-                break;
+        std::vector<int> matchedids;
+        _patternids( linecache.line( 0 ), linecache.linesize( 0 ), matchedids );
+
+        for( int matchedid : matchedids ) {
+            PyObject* pythonobject = PyLong_FromLong( matchedid );
+
+            if( pythonobject == NULL || PyList_Append( patternidslist, pythonobject ) ) {
+                Py_XDECREF( pythonobject );
+                Py_DECREF( patternidslist );
+                return NULL;
             }
+            Py_DECREF( pythonobject );
         }
-    #elif FASTFILE_GETLINE == FASTFILE_GETLINE_STDGETLINE
-        if( !fileifstream.eof() )
-        {
-            linecount += 1;
-            fileifstream.getline( readline, linebuffersize );
-            charsread = fileifstream.gcount();
+        return patternidslist;
+    }
 
-            FASTFILE_UTF8CHARACTER_TRIMMING
-            readline[charsread] = '\0';
+    // Makes the next lines returned tuples with their fields, see FastFileFieldSplitter, including
+    // the empty line after the file end
+    bool fields(const FastFileFieldOptions& fieldoptions) {
+        _waitreading();
+        int character = fastfile_keptcharacter( FASTFILE_TRIMUFT8, fieldoptions.delimiter );
 
-            PyObject* pythonobject = PyUnicode_DecodeUTF8( readline, charsread, "ignore" );
-            linecache.push_back( pythonobject );
+        if( character != keptcharacter && character != FASTFILE_TRIMUFT8_KEEPNONE && !hasclosed && !_keepcharacter( character ) ) {
+            PyErr_SetString( PyExc_ValueError, "FastFile fields delimiter is removed from the lines already read by "
+                    "FASTFILE_TRIMUFT8, call fields() before reading any line, or use the constructor delimiter keyword" );
+            return false;
+        }
+        linecache.setfields( fieldoptions );
 
-            // Py_XINCREF( emtpycacheobject );
-            // linecache.push_back( emtpycacheobject );
-            LOG( 1, "linecount %llu currentline %llu readline '%p' '%s'", linecount, currentline, pythonobject, readline );
+        if( hasclosed ) {
             return true;
         }
-    #elif FASTFILE_GETLINE == FASTFILE_GETLINE_DISABLED
-        PyObject* readpyline = PyObject_CallObject( fileiterator, NULL );
-
-        if( readpyline != NULL ) {
-            linecount += 1;
 
-            // we cannot modify a Python string! Then, to remove a trailling new line, we must to
-            // create a new python string without the trailling new line!
-        #if FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_PRINTABLEONLY
-            const char* cppline = PyUnicode_AsUTF8AndSize( readpyline, &charsread );
+        FastFileLineSpan emptyspan = { "", 0, 0, NULL };
+        PyObject* emptyfields = linecache._newfields( emptyspan );
 
-            if( cppline == NULL ) {
-                PyErr_PrintEx(100);
-                std::cerr << "ERROR: FastFile failed to get Python cppline '"
-                        << filepath << "'" << std::endl;
-                return false;
-            }
+        if( emptyfields == NULL ) {
+            return false;
+        }
 
-            if( charsread + 1 > static_cast<long long int>( linebuffersize ) )
-            {
-                // Allocate charsread + 1 because the charsread variable does not include the end null byte '\0'
-                char* reallocresult = (char*) malloc( charsread + 1 );
-
-                if( reallocresult == NULL ) {
-                    charsread = linebuffersize - 1;
-                    std::cerr << "ERROR: FastFile failed to alocate internal for reallocresult '"
-                            << filepath << "' new size '" << charsread + 1 << "' old size '"
-                            << linebuffersize << "'" << std::endl;
-                }
-                else {
-                    LOG( 1, "Alocating internal line buffer for reallocresult '%s' new size '%s' old size '%s'",
-                            filepath, charsread + 1, linebuffersize );
+        Py_XDECREF( emtpycacheobject );
+        emtpycacheobject = emptyfields;
+        return true;
+    }
 
-                    free( readline );
-                    readline = reallocresult;
-                    linebuffersize = charsread + 1;
-                }
+    // Returns a dictionary with the line cache arena high-water marks, i.e., the most bytes and
+    // blocks held at once by the cached lines, how many blocks were allocated, and how many blocks
+    // were given up because some memoryview still pinned them. Also, how many lines were found or
+    // not by the `dedup` cache.
+    PyObject* stats() {
+        _waitreading();
+        const FastFileArenaStats& arenastats = linecache.arena.stats;
+
+        return Py_BuildValue( "{s:n,s:n,s:n,s:n,s:n,s:n,s:n}",
+                "arenablocksize", static_cast<Py_ssize_t>( FASTFILE_ARENA_BLOCKSIZE ),
+                "arenamallocs", static_cast<Py_ssize_t>( arenastats.mallocs ),
+                "arenadetached", static_cast<Py_ssize_t>( arenastats.detached ),
+                "arenapeakblocks", static_cast<Py_ssize_t>( arenastats.peakblocks ),
+                "arenapeakbytes", static_cast<Py_ssize_t>( arenastats.peakbytes ),
+                "deduphits", static_cast<Py_ssize_t>( linecache.dedup.hits ),
+                "dedupmisses", static_cast<Py_ssize_t>( linecache.dedup.misses ) );
+    }
+
+    // Moves the iterator to the line `line`, counting from zero all the file lines, even the ones
+    // the regex filter skips, i.e., the next line returned is the first line matching from there on.
+    // The first call waits for the line index, building it if the `lineindex` keyword did not.
+    PyObject* seekline(Py_ssize_t line) {
+        _waitreading();
+
+        if( line < 0 ) {
+            PyErr_SetString( PyExc_ValueError, "FastFile seekline line must be zero or a positive line number" );
+            return NULL;
+        }
+
+        if( isbuiltins ) {
+            PyErr_SetString( PyExc_ValueError, "FastFile builtins backend does not support seekline" );
+            return NULL;
+        }
+
+        if( hasclosed || !isseekable ) {
+            PyErr_Format( PyExc_ValueError, "FastFile file '%s' is not open for seekline, or it is reversed or compressed", filepath.c_str() );
+            return NULL;
+        }
+
+        bool isindexed;
+        _beginreading();
+        Py_BEGIN_ALLOW_THREADS
+        isindexed = lineindex.wait();
+        Py_END_ALLOW_THREADS
+        _endreading();
+
+        if( !isindexed ) {
+            PyErr_Format( PyExc_OSError, "FastFile failed to index the lines of the file '%s'", filepath.c_str() );
+            return NULL;
+        }
+
+        uint64_t offset;
+        uint64_t skiplines;
+        lineindex.find( line, offset, skiplines );
+
+        while( linecache.size() ) {
+            linecache.pop_front();
+        }
+        currentline = -1;
+        getnewline = false;
+        linecount = std::min( static_cast<uint64_t>( line ), lineindex.lines );
+
+        bool hasseeked;
+        _beginreading();
+        Py_BEGIN_ALLOW_THREADS
+        hasseeked = _seek( offset, skiplines );
+        Py_END_ALLOW_THREADS
+        _endreading();
+
+        LOG( 1, "line %zd offset %llu skiplines %llu hasseeked %d", line, offset, skiplines, hasseeked );
+
+        // after the last line, there is nothing to read, not even the std backend empty last line
+        hasfinished = !hasseeked || static_cast<uint64_t>( line ) >= lineindex.lines;
+
+        if( !hasseeked ) {
+            PyErr_Format( PyExc_OSError, "FastFile failed to seek the file '%s'", filepath.c_str() );
+            return NULL;
+        }
+
+        Py_INCREF( Py_None );
+        return Py_None;
+    }
+
+    bool next() {
+        _waitreading();
+        currentline = -1;
+
+        getnewline = enableregex;
+        if( linecache.size() ) {
+            linecache.pop_front();
+
+            // the reversed lines do not end with an empty line after the file first line
+            return !isreversed || linecache.size() || _getline();
+        }
+        bool hasnextline = _getline();
+
+        LOG( 1, "hasnextline: %d linecount %llu currentline %llu", hasnextline, linecount, currentline );
+        return hasnextline;
+    }
+
+    // Returns a borrowed reference to the current line, or NULL when its Python string could not be
+    // created. The lines skipped by the regex filter are dropped without creating their strings.
+    PyObject* call()
+    {
+        if( !_callline() ) {
+            // following a file only stops when some signal handler raised an exception
+            return PyErr_Occurred() ? NULL : emtpycacheobject;
+        }
+        return linecache.object( currentline );
+    }
+
+    // Moves `currentline` to the line call() returns, returning false on the file end
+    bool _callline()
+    {
+        _waitreading();
+        currentline += 1;
+        LOG( 1, "linecache.size %zd linecount %llu currentline %llu", linecache.size(), linecount, currentline );
+
+        if( getnewline ) {
+            while( linecache.size() && !_matchline( linecache.line( 0 ), linecache.linesize( 0 ) ) ) {
+                linecache.pop_front();
             }
+        }
 
-            lineend = cppline + charsread;
-            destination = readline;
-            for( source = cppline; source != lineend; ++source )
+        if( currentline < static_cast<long long int>( linecache.size() ) )
+        {
+            getnewline = false;
+            return true;
+        }
+        else
+        {
+            if( !_getline() )
             {
-                fixedchar = static_cast<unsigned int>( *source );
-                if( 31 < fixedchar && fixedchar < 128 ) {
-                    *destination = *source;
-                    ++destination;
-                }
-                else {
-                    --charsread;
-                }
+                LOG( 1, "Raising StopIteration" );
+                return false;
+            }
+        }
+        LOGCD( 1, std::ostringstream contents; for( size_t index = 0; index < linecache.size(); ++index ) contents << std::string( linecache.line( index ), linecache.linesize( index ) ); LOG( 1, "contents %s**\n**linecache.size %zd linecount %llu currentline %llu", contents.str().c_str(), linecache.size(), linecount, currentline ) );
+        return true;
+    }
+
+    // Return a new list with up to `maximumlines` lines (or all the remaining lines when negative),
+    // stopping earlier after reading `maximumsize` characters (when positive). Each line is read
+    // exactly as calling next() and call(), i.e., as iterating over the file, but without going
+    // back to the Python interpreter for each line.
+    PyObject* readlines(Py_ssize_t maximumlines, Py_ssize_t maximumsize) {
+        // lists bigger than this grow as lines are appended, instead of being allocated upfront
+        const Py_ssize_t preallocationlimit = 65536;
+
+        bool ispreallocated = 0 <= maximumlines && maximumlines <= preallocationlimit;
+        PyObject* pythonlist = PyList_New( ispreallocated ? maximumlines : 0 );
+
+        if( pythonlist == NULL ) {
+            return NULL;
+        }
+
+        Py_ssize_t linesread = 0;
+        Py_ssize_t charsread = 0;
+
+        while( ( maximumlines < 0 || linesread < maximumlines )
+                && ( maximumsize <= 0 || charsread < maximumsize )
+                && next() )
+        {
+            PyObject* pythonobject = call();
+
+            if( pythonobject == NULL ) {
+                Py_DECREF( pythonlist );
+                return NULL;
+            }
+            charsread += fastfile_objectlength( pythonobject ) + 1;
+
+            if( ispreallocated ) {
+                Py_INCREF( pythonobject );
+                PyList_SET_ITEM( pythonlist, linesread, pythonobject );
+            }
+            else if( PyList_Append( pythonlist, pythonobject ) ) {
+                Py_DECREF( pythonlist );
+                return NULL;
+            }
+            ++linesread;
+        }
+
+        LOG( 1, "linesread %zd charsread %zd linecount %llu currentline %llu", linesread, charsread, linecount, currentline );
+
+        if( ispreallocated && linesread < maximumlines ) {
+            if( PyList_SetSlice( pythonlist, linesread, maximumlines, NULL ) ) {
+                Py_DECREF( pythonlist );
+                return NULL;
+            }
+        }
+        return pythonlist;
+    }
+
+    // Returns a tuple with one column for each of the fields() `columns`, with the next lines up to
+    // `maximumlines` (or all the remaining lines when negative). The lines are read as readlines()
+    // does, but their fields go straight into the column buffers, then, the row `n` of the columns
+    // is the `n` line, and an empty line has the same null fields fields() returns for it.
+    PyObject* readcolumns(Py_ssize_t maximumlines) {
+        std::vector<FastFileColumnData*> columndatas;
+        Py_ssize_t linesread = 0;
+
+        for( size_t index = 0; index < linecache.fieldoptions.columns.size(); ++index ) {
+            columndatas.push_back( new FastFileColumnData( linecache.fieldtype( index ) ) );
+        }
+
+        bool haserror = false;
+        while( ( maximumlines < 0 || linesread < maximumlines ) && next() ) {
+            if( !_callline() ) {
+                haserror = PyErr_Occurred() != NULL;
+                break;
             }
-        #elif FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_DISABLED
-            char* readline = PyUnicode_AsUTF8AndSize( readpyline, &charsread );
+
+            if( !linecache.appendcolumns( currentline, columndatas ) ) {
+                haserror = true;
+                break;
+            }
+            ++linesread;
+        }
+
+        LOG( 1, "linesread %zd linecount %llu currentline %llu", linesread, linecount, currentline );
+        PyObject* columns = haserror ? NULL : PyTuple_New( columndatas.size() );
+
+        for( size_t index = 0; index < columndatas.size(); ++index ) {
+            if( columns == NULL ) {
+                delete columndatas[index];
+                continue;
+            }
+
+            PyObject* column = fastfile_newcolumn( columndatas[index] );
+
+            if( column == NULL ) {
+                Py_CLEAR( columns );
+                continue;
+            }
+            PyTuple_SET_ITEM( columns, index, column );
+        }
+        return columns;
+    }
+};
+
+
+// Reads the file with the Python builtins.open(), it does not support any regex engine
+struct FastFileBuiltins : FastFile {
+    PyObject* iomodule;
+    PyObject* openfile;
+    PyObject* fileiterator;
+
+    FastFileBuiltins(const char* filepath, const FastFileLineOptions& lineoptions) :
+                FastFile( filepath, lineoptions ),
+                iomodule(NULL),
+                openfile(NULL),
+                fileiterator(NULL)
+    {
+        LOG( 1, "Constructor with:\nbackend=builtins\nmode=%s\ndedup=%s\nFASTFILE_TRIMUFT8=%s\nfilepath=%s",
+                lineoptions.mode, lineoptions.dedup, FASTFILE_TRIMUFT8, filepath );
+        isbuiltins = true;
+
+        if( hasfinished ) {
+            return;
+        }
+        hasfinished = true;
+
+        // https://stackoverflow.com/questions/47054623/using-python3-c-api-to-add-to-builtins
+        iomodule = PyImport_ImportModule( "builtins" );
+
+        if( iomodule == NULL ) {
+            std::cerr << "ERROR: FastFile failed to import the io module (and open the file '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        PyObject* openfunction = PyObject_GetAttrString( iomodule, "open" );
+
+        if( openfunction == NULL ) {
+            std::cerr << "ERROR: FastFile failed get the io module open function (and open the file '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        // https://stackoverflow.com/questions/56482802/c-python-api-extensions-is-ignoring-openerrors-ignore-and-keeps-throwing-the
+        openfile = PyObject_CallFunction( openfunction, "ssiss", filepath, "r", -1, "UTF8", "ignore" );
+
+        if( openfile == NULL ) {
+            std::cerr << "ERROR: FastFile failed to open the file'"
+                    << filepath << "'!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        PyObject* iterfunction = PyObject_GetAttrString( openfile, "__iter__" );
+        Py_DECREF( openfunction );
+
+        if( iterfunction == NULL ) {
+            std::cerr << "ERROR: FastFile failed get the io module iterator function (and open the file '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        PyObject* openiteratorobject = PyObject_CallObject( iterfunction, NULL );
+        Py_DECREF( iterfunction );
+
+        if( openiteratorobject == NULL ) {
+            std::cerr << "ERROR: FastFile failed get the io module iterator object (and open the file '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        fileiterator = PyObject_GetAttrString( openfile, "__next__" );
+        Py_DECREF( openiteratorobject );
+
+        if( fileiterator == NULL ) {
+            std::cerr << "ERROR: FastFile failed get the io module iterator object (and open the file '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        hasfinished = false;
+    }
+
+    ~FastFileBuiltins() {
+        if( !hasclosed ) {
+            this->close();
+        }
+    }
+
+    void _close() {
+        if( openfile == NULL ) {
+            Py_XDECREF( iomodule );
+            return;
+        }
+        PyObject* closefunction = PyObject_GetAttrString( openfile, "close" );
+
+        if( closefunction == NULL ) {
+            std::cerr << "ERROR: FastFile failed get the close file function for '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+
+        PyObject* closefileresult = PyObject_CallObject( closefunction, NULL );
+        Py_DECREF( closefunction );
+
+        if( closefileresult == NULL ) {
+            std::cerr << "ERROR: FastFile failed close open file '"
+                    << filepath << "')!" << std::endl;
+            PyErr_PrintEx(100);
+            return;
+        }
+        Py_DECREF( closefileresult );
+
+        Py_XDECREF( iomodule );
+        Py_XDECREF( openfile );
+        Py_XDECREF( fileiterator );
+    }
+
+    // https://stackoverflow.com/questions/56260096/how-to-improve-python-c-extensions-file-line-reading
+    bool _getline() {
+        // Fix StopIteration being raised multiple times because _getlines is called multiple times
+        if( hasfinished ) { return false; }
+
+        ssize_t charsread;
+        PyObject* readpyline = PyObject_CallObject( fileiterator, NULL );
+
+        if( readpyline != NULL ) {
+            linecount += 1;
+
+            // we cannot modify a Python string! Then, to remove a trailling new line, we must to
+            // create a new python string without the trailling new line!
+        #if FASTFILE_TRIMUFT8 != FASTFILE_TRIMUFT8_DISABLED
+            const char* cppline = PyUnicode_AsUTF8AndSize( readpyline, &charsread );
+
+            if( cppline == NULL ) {
+                PyErr_PrintEx(100);
+                std::cerr << "ERROR: FastFile failed to get Python cppline '"
+                        << filepath << "'" << std::endl;
+                return false;
+            }
+
+            // the trimming also removes the new line character, while copying the line into the cache
+            bool haspushed = linecache.pushtrimmed( cppline, charsread, FASTFILE_TRIMUFT8, keptcharacter );
+
+            LOG( 1, "linecount %llu currentline %llu readpyline '%p' '%s'",
+                    linecount, currentline, readpyline, std::string( cppline, charsread ) );
+        #else
+            const char* readline = PyUnicode_AsUTF8AndSize( readpyline, &charsread );
 
             if( readline == NULL ) {
                 PyErr_PrintEx(100);
@@ -660,94 +780,557 @@ struct FastFile {
                         << filepath << "'" << std::endl;
                 return false;
             }
-        #endif
-            --charsread;
-            if( readline[charsread] == '\n' ) {
-            }
-            else {
-                ++charsread;
+
+            if( charsread && readline[charsread - 1] == '\n' ) {
+                --charsread;
             }
 
-            PyObject* newpyline = PyUnicode_DecodeUTF8( readline, charsread, "ignore" );
-            LOG( 1, "linecount %llu currentline %llu newpyline '%p' '%s'",
-                    linecount, currentline, readpyline, PyUnicode_AsUTF8( newpyline ) );
+            LOG( 1, "linecount %llu currentline %llu readpyline '%p' '%s'",
+                    linecount, currentline, readpyline, std::string( readline, charsread ) );
 
+            bool haspushed = linecache.push( readline, charsread );
+        #endif
             Py_DECREF( readpyline );
-            linecache.push_back( newpyline );
-            return true;
+
+            if( !haspushed ) {
+                hasfinished = true;
+            }
+            return haspushed;
         }
         // PyErr_PrintEx(100); // uncomment this to see why this function is stopping
         PyErr_Clear();
-    #endif
 
         hasfinished = true;
         return false;
     }
+};
 
-    bool next() {
-        currentline = -1;
 
-    #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-        getnewline = enableregex;
+/**
+ * The native backends, specialized for each file reader from fastfilebackends.h and each regex
+ * engine from fastfileengines.h. The whole read, trim and match loop is compiled for each pair,
+ * then, the backend and engine calls are inlined, and their options are compile time constants.
+ */
+template<typename Backend, typename Engine>
+struct FastFileCore : FastFile {
+    Backend backend;
+    Engine engine;
+
+    // The lines are read first, and only matched after the whole batch was read
+    static const bool isbatchmatching = FASTFILE_REGEXTHREADS
+            || ( FASTFILE_REGEXBUFFER && Engine::engine == FASTFILE_REGEX_HYPERSCAN );
+
+    static const bool istrimming = FASTFILE_TRIMUFT8 != FASTFILE_TRIMUFT8_DISABLED && !Backend::istrimmed;
+
+    std::vector<FastFileBatchLine> batchlines;
+    size_t batchcursor;
+    bool batchfinished;
+
+    // After reverse(), the lines come from `reversereader` instead of the backend
+    FastFileReverseReader reversereader;
+
+    // With the `follow` keyword, the file end waits for more lines instead of finishing
+    FastFileFollower follower;
+
+    char* batchbuffer;
+    size_t batchbuffersize;
+    size_t batchbufferused;
+
+#if FASTFILE_REGEXTHREADS
+    FastFileWorkers regexworkers;
+#endif
+
+    // Each pattern is identified by its index on `patterns`, see patternids()
+    FastFileCore(const char* filepath, const std::vector<std::string>& patterns, const FastFileLineOptions& lineoptions) :
+                FastFile( filepath, lineoptions ),
+                batchcursor(0),
+                batchfinished(false),
+                batchbuffer(NULL),
+                batchbuffersize(0),
+                batchbufferused(0)
+    {
+        LOG( 1, "Constructor with:\nbackend=%s\nengine=%s\nmode=%s\ndedup=%s\nFASTFILE_TRIMUFT8=%s\nfilepath=%s\npatterns=%s",
+                static_cast<int>( Backend::backend ), static_cast<int>( Engine::engine ), lineoptions.mode, lineoptions.dedup,
+                FASTFILE_TRIMUFT8, filepath, patterns.size() );
+
+        batchlines.reserve( FASTFILE_LINEBATCH_LINES );
+
+        if( hasfinished ) {
+            return;
+        }
+
+        backend.isfollowing = isfollowing;
+        backend.keptcharacter = keptcharacter;
+        if( !backend.open( filepath ) ) {
+            hasfinished = true;
+            return;
+        }
+        isseekable = !backend.iscompressed;
+
+        if( isfollowing ) {
+            follower.start( this->filepath );
+        }
+
+        lineindex.usemapping = Backend::backend == FASTFILE_GETLINE_MEMORYMAP;
+        if( lineoptions.lineindex ) {
+            lineindex.start();
+        }
+
+        if( Engine::engine != FASTFILE_REGEX_DISABLED && ( patterns.size() > 1 || patterns[0].size() ) ) {
+            enableregex = engine.compile( this->filepath.c_str(), patterns );
+            LOG( 1, "Setting enableregex to %s", enableregex );
+        }
+
+    #if FASTFILE_REGEXTHREADS
+        if( enableregex && engine.reserve( FASTFILE_REGEXTHREADS ) ) {
+            regexworkers.start( FASTFILE_REGEXTHREADS );
+        }
     #endif
-        if( linecache.size() ) {
-            Py_DECREF( linecache[0] );
-            linecache.pop_front();
+    }
+
+    ~FastFileCore() {
+        if( !hasclosed ) {
+            this->close();
+        }
+    }
+
+    void _close() {
+        if( batchbuffer ) {
+            free( batchbuffer );
+            batchbuffer = NULL;
+        }
+        batchlines.clear();
+        batchcursor = 0;
+
+        backend.close();
+        reversereader.close();
+        follower.stop();
+
+    #if FASTFILE_REGEXTHREADS
+        regexworkers.stop();
+    #endif
+        engine.close();
+    }
+
+    // The read ahead thread already trimmed the lines it read ahead, then, it starts again from the
+    // file start, which a compressed file cannot do
+    bool _keepcharacter(int character) {
+        bool isrestarting = Backend::istrimmed && !isreversed;
+
+        if( batchlines.size() || ( isrestarting && !isseekable ) || !FastFile::_keepcharacter( character ) ) {
+            return false;
+        }
+
+        backend.keptcharacter = character;
+        return !isrestarting || backend.seek( 0 );
+    }
+
+    bool reverse() {
+        if( backend.iscompressed ) {
+            return false;
+        }
+
+        if( !isseekable ) {
             return true;
         }
-        bool hasnextline = _getline();
 
-        LOG( 1, "hasnextline: %d linecount %llu currentline %llu", hasnextline, linecount, currentline );
-        return hasnextline;
+        // the lines do not come from the backend anymore, nor the line index is used
+        lineindex.stop();
+        follower.stop();
+        backend.close();
+        isseekable = false;
+        isreversed = true;
+        isfollowing = false;
+
+        if( !reversereader.open( filepath.c_str() ) ) {
+            hasfinished = true;
+        }
+        return true;
     }
 
-    PyObject* call()
-    {
-        currentline += 1;
-        LOG( 1, "linecache.size %zd linecount %llu currentline %llu", linecache.size(), linecount, currentline );
+    // Waits without holding the GIL until the file grows, then, it is opened again to read the new
+    // lines from where the backend stopped, or from the start of a truncated or replaced file. A
+    // rotated file is read up to its end, including its last line without a new line character,
+    // before the new file. Returns false after close() or an exception raised by some signal handler.
+    bool _follow() {
+        uint64_t offset = backend.tell();
 
-    #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-        if( getnewline ) {
-            Py_ssize_t charsread;
-            long int popfrontcount = 0;
+        while( true ) {
+            int change;
+            _beginreading();
+            Py_BEGIN_ALLOW_THREADS
+            change = follower.wait( offset, FASTFILE_FOLLOW_WAKEUP );
+            Py_END_ALLOW_THREADS
+            _endreading();
+
+            if( !isfollowing || hasclosed || PyErr_CheckSignals() ) {
+                return false;
+            }
+
+            if( change == FASTFILE_FOLLOW_WAITING ) {
+                continue;
+            }
+
+            LOG( 1, "change %d offset %llu", change, static_cast<unsigned long long>( offset ) );
+            if( change == FASTFILE_FOLLOW_TRUNCATED || change == FASTFILE_FOLLOW_REPLACED ) {
+                offset = 0;
+            }
 
-            int returncode;
-            const char* readline;
+            // the memory mapping only sees the file size it was opened with
+            bool isrotated = change == FASTFILE_FOLLOW_ROTATED;
+            backend.close();
+            backend.isfollowing = !isrotated;
 
-            for( PyObject* pyobject : linecache ) {
-                readline = PyUnicode_AsUTF8AndSize( pyobject, &charsread );
+            if( !backend.open( isrotated ? follower.descriptorpath.c_str() : filepath.c_str() ) || !backend.seek( offset ) ) {
+                continue;
+            }
+
+            batchfinished = false;
+            return true;
+        }
+    }
+
+    bool _nextline(const char*& readline, size_t& charsread, bool& hasnewline) {
+        if( isreversed ) {
+            return reversereader.previous( readline, charsread, hasnewline );
+        }
+        return backend.next( readline, charsread, hasnewline );
+    }
+
+    bool _seek(uint64_t offset, uint64_t skiplines) {
+        batchlines.clear();
+        batchcursor = 0;
+        batchbufferused = 0;
+        batchfinished = false;
+        backend.release();
+
+        if( !backend.seek( offset ) ) {
+            return false;
+        }
+
+        const char* readline;
+        size_t charsread;
+        bool hasnewline;
+
+        // the skipped lines are never used, then, their memory is given back right away
+        for( ; skiplines; --skiplines ) {
+            backend.release();
+
+            if( !backend.next( readline, charsread, hasnewline ) ) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool _matchline(const char* readline, size_t charsread) {
+        return engine.match( readline, charsread, 0 );
+    }
 
-                if( REGEXMATCHFUNCTION ) {
+    void _patternids(const char* readline, size_t charsread, std::vector<int>& matchedids) {
+        engine.patternids( readline, charsread, matchedids );
+    }
+
+    // Returns where a line with up to `size` characters can be copied into the batch buffer
+    char* _reservebatchline(size_t size) {
+        if( batchbufferused + size + 1 > batchbuffersize )
+        {
+            size_t newsize = ( batchbufferused + size + 1 ) * 2;
+            char* reallocresult = (char*) realloc( batchbuffer, newsize );
+
+            if( reallocresult == NULL ) {
+                std::cerr << "ERROR: FastFile failed to alocate the batch buffer for '"
+                        << filepath << "' new size '" << newsize << "' old size '"
+                        << batchbuffersize << "'" << std::endl;
+                return NULL;
+            }
+
+            batchbuffer = reallocresult;
+            batchbuffersize = newsize;
+        }
+        return batchbuffer + batchbufferused;
+    }
+
+    // Reads, trims and matches the next lines. It is called without holding the GIL, then, it must
+    // not touch any Python object.
+    void _readbatch() {
+        const char* readline;
+        size_t charsread;
+        bool hasnewline;
+
+        batchlines.clear();
+        batchcursor = 0;
+        batchbufferused = 0;
+        backend.release();
+
+        // the lines before the first match would be skipped by _getline() anyway
+        bool isskipping = getnewline && !isbatchmatching;
+
+        // the backends trimming their own lines are not used by the reversed lines
+        bool istrimmingline = istrimming || ( Backend::istrimmed && isreversed );
+
+        while( batchlines.size() < FASTFILE_LINEBATCH_LINES && batchbufferused < FASTFILE_LINEBATCH_SIZE )
+        {
+            // give back the lines already read instead of waiting for the next ones
+            if( batchlines.size() && !isreversed && !backend.isready() ) {
+                break;
+            }
+
+            if( !_nextline( readline, charsread, hasnewline ) ) {
+                batchfinished = true;
+                break;
+            }
+
+            FastFileBatchLine batchline = { batchbufferused, charsread, NULL, hasnewline, true };
+
+            // the stable lines are only copied when some character has to be removed by the UTF-8 trimming
+            if( Backend::isstable && !isreversed && ( !istrimmingline || fastfile_trimmedprefixkeeping( FASTFILE_TRIMUFT8, keptcharacter, readline, charsread ) == charsread ) ) {
+                batchline.mappedline = readline;
+            }
+            else {
+                char* destination = _reservebatchline( charsread );
+
+                if( destination == NULL ) {
                     break;
                 }
 
-                REGEXERRORFUNCTION
-                ++popfrontcount;
+                if( istrimmingline ) {
+                    batchline.size = fastfile_trimlinekeeping( FASTFILE_TRIMUFT8, keptcharacter, destination, readline, charsread );
+                }
+                else {
+                    memcpy( destination, readline, charsread );
+                }
+
+                // the whole buffer can be scanned as a text with one line after another
+                destination[batchline.size] = '\n';
+                readline = destination;
             }
 
-            while( popfrontcount-- ) {
-                Py_DECREF( linecache[0] );
-                linecache.pop_front();
+            // without the UTF-8 trimming, the regex also sees the line new line character
+            if( enableregex && !isbatchmatching ) {
+                batchline.hasmatched = engine.match( readline,
+                        batchline.size FASTFILE_ISTRIM_UFT8_DISABLED( + batchline.hasnewline ), 0 );
+
+                // the batch has no line yet, then, the read ahead thread can reuse the skipped lines chunks
+                if( !batchline.hasmatched && isskipping ) {
+                    backend.release();
+                    continue;
+                }
+                isskipping = false;
             }
+
+            if( !batchline.mappedline ) {
+                batchbufferused += batchline.size + 1;
+            }
+            batchlines.push_back( batchline );
+        }
+
+        if( isbatchmatching && enableregex ) {
+            _matchbatch();
         }
+        LOG( 1, "batchlines %zd batchbufferused %zd batchfinished %d", batchlines.size(), batchbufferused, batchfinished );
+    }
+
+    // Splits the batch lines between the workers, each one matching its own slice of lines
+    void _matchbatch() {
+    #if FASTFILE_REGEXTHREADS
+        size_t batchsize = batchlines.size();
+        unsigned int workercount = regexworkers.size();
+
+        regexworkers.run( [&]( unsigned int worker ) {
+            _matchbatchlines( batchsize * worker / workercount, batchsize * ( worker + 1 ) / workercount, worker );
+        } );
+    #else
+        _matchbatchlines( 0, batchlines.size(), 0 );
     #endif
+    }
 
-        if( currentline < static_cast<long long int>( linecache.size() ) )
-        {
-        #if FASTFILE_REGEX != FASTFILE_REGEX_DISABLED
-            getnewline = false;
-        #endif
-            return linecache[currentline];
+    void _matchbatchlines(size_t firstline, size_t lastline, unsigned int worker) {
+        size_t index = firstline;
+
+        while( index < lastline ) {
+            size_t runend = _contiguousend( index, lastline );
+
+            if( !engine.scanbuffer( batchbuffer, batchlines, index, runend, FASTFILE_TRIMUFT8 == FASTFILE_TRIMUFT8_DISABLED, worker ) ) {
+                break;
+            }
+            index = runend;
         }
-        else
-        {
-            if( !_getline() )
+
+        for( ; index < lastline; ++index ) {
+            FastFileBatchLine& batchline = batchlines[index];
+            const char* readline = batchline.mappedline ? batchline.mappedline : batchbuffer + batchline.offset;
+
+            batchline.hasmatched = engine.match( readline,
+                    batchline.size FASTFILE_ISTRIM_UFT8_DISABLED( + batchline.hasnewline ), worker );
+        }
+    }
+
+    // Returns where the lines from `firstline` stop being one right after another with only a new line
+    // character between them, as the lines copied into the batch buffer, or the lines of a mapping or
+    // of a read ahead chunk, which stop on a line trimmed in place or on the chunk end
+    size_t _contiguousend(size_t firstline, size_t lastline) {
+        for( size_t index = firstline + 1; index < lastline; ++index ) {
+            const FastFileBatchLine& previous = batchlines[index - 1];
+            const FastFileBatchLine& batchline = batchlines[index];
+
+            if( !previous.hasnewline || !previous.mappedline != !batchline.mappedline
+                    || batchline.start( batchbuffer ) != previous.start( batchbuffer ) + previous.size + 1 )
             {
-                LOG( 1, "Raising StopIteration" );
-                return emtpycacheobject;
+                return index;
             }
         }
-        LOGCD( 1, std::ostringstream contents; for( auto value : linecache ) contents << PyUnicode_AsUTF8( value ); LOG( 1, "contents %s**\n**linecache.size %zd linecount %llu currentline %llu (%p)", contents.str().c_str(), linecache.size(), linecount, currentline, linecache[currentline] ) );
-        return linecache[currentline];
+        return lastline;
+    }
+
+    bool _getline() {
+        // Fix StopIteration being raised multiple times because _getlines is called multiple times
+        if( hasfinished ) { return false; }
+
+        while( true ) {
+            if( batchcursor == batchlines.size() ) {
+                if( batchfinished && !( isfollowing && _follow() ) ) {
+                    break;
+                }
+
+                _beginreading();
+                Py_BEGIN_ALLOW_THREADS
+                _readbatch();
+                Py_END_ALLOW_THREADS
+                _endreading();
+                continue;
+            }
+
+            const FastFileBatchLine& batchline = batchlines[batchcursor++];
+
+            if( getnewline && !batchline.hasmatched ) {
+                continue;
+            }
+            getnewline = false;
+            ++linecount;
+
+            const char* linestart = batchline.mappedline ? batchline.mappedline : batchbuffer + batchline.offset;
+            LOG( 1, "linecount %llu currentline %llu linestart '%s'", linecount, currentline,
+                    std::string( linestart, batchline.size ) );
+
+            if( !linecache.push( linestart, batchline.size ) ) {
+                break;
+            }
+            return true;
+        }
+
+        hasfinished = true;
+        return false;
     }
 };
+
+
+// The names accepted by the `backend`, `engine`, `mode` and `types` constructor keywords
+struct FastFileOption {
+    const char* name;
+    int value;
+};
+
+static const FastFileOption fastfile_backends[] = {
+    { "builtins", FASTFILE_GETLINE_DISABLED },
+    { "std", FASTFILE_GETLINE_STDGETLINE },
+#if defined(__unix__)
+    { "posix", FASTFILE_GETLINE_POSIXGETLINE },
+    { "mmap", FASTFILE_GETLINE_MEMORYMAP },
+    { "readahead", FASTFILE_GETLINE_READAHEAD },
+    { "uring", FASTFILE_GETLINE_URING },
+#endif
+    { NULL, 0 }
+};
+
+static const FastFileOption fastfile_engines[] = {
+    { "none", FASTFILE_REGEX_DISABLED },
+#if FASTFILE_WITH_C_ENGINE
+    { "regex.h", FASTFILE_REGEX_C_ENGINE },
+#endif
+#if FASTFILE_WITH_PCRE2
+    { "pcre2", FASTFILE_REGEX_PCRE2 },
+#endif
+#if FASTFILE_WITH_RE2
+    { "re2", FASTFILE_REGEX_RE2 },
+#endif
+#if FASTFILE_WITH_HYPERSCAN
+    { "hyperscan", FASTFILE_REGEX_HYPERSCAN },
+#endif
+    { NULL, 0 }
+};
+
+static const FastFileOption fastfile_modes[] = {
+    { "text", FASTFILE_MODE_TEXT },
+    { "bytes", FASTFILE_MODE_BYTES },
+    { "view", FASTFILE_MODE_VIEW },
+    { NULL, 0 }
+};
+
+static const FastFileOption fastfile_types[] = {
+    { "str", FASTFILE_TYPE_STR },
+    { "bytes", FASTFILE_TYPE_BYTES },
+    { "int", FASTFILE_TYPE_INT },
+    { "float", FASTFILE_TYPE_FLOAT },
+    { NULL, 0 }
+};
+
+// Returns the value of the option called `name`, or -1 when it was not compiled into the module
+static inline int fastfile_findoption(const FastFileOption* options, const char* name) {
+    for( ; options->name != NULL; ++options ) {
+        if( strcmp( options->name, name ) == 0 ) {
+            return options->value;
+        }
+    }
+    return -1;
+}
+
+template<typename Backend>
+static inline FastFile* fastfile_createcore(const char* filepath, const std::vector<std::string>& patterns, int engine,
+        const FastFileLineOptions& lineoptions)
+{
+    switch( engine ) {
+    #if FASTFILE_WITH_C_ENGINE
+        case FASTFILE_REGEX_C_ENGINE:
+            return new FastFileCore<Backend, FastFileCEngine>( filepath, patterns, lineoptions );
+    #endif
+    #if FASTFILE_WITH_PCRE2
+        case FASTFILE_REGEX_PCRE2:
+            return new FastFileCore<Backend, FastFilePcre2Engine>( filepath, patterns, lineoptions );
+    #endif
+    #if FASTFILE_WITH_RE2
+        case FASTFILE_REGEX_RE2:
+            return new FastFileCore<Backend, FastFileRe2Engine>( filepath, patterns, lineoptions );
+    #endif
+    #if FASTFILE_WITH_HYPERSCAN
+        case FASTFILE_REGEX_HYPERSCAN:
+            return new FastFileCore<Backend, FastFileHyperscanEngine>( filepath, patterns, lineoptions );
+    #endif
+        default:
+            return new FastFileCore<Backend, FastFileNoEngine>( filepath, patterns, lineoptions );
+    }
+}
+
+// Creates the FastFile specialized for a backend and a regex engine from the tables above, the
+// builtins backend ignores the regex
+static inline FastFile* fastfile_create(const char* filepath, const std::vector<std::string>& patterns,
+        int backend=FASTFILE_DEFAULTBACKEND, int engine=FASTFILE_DEFAULTENGINE,
+        const FastFileLineOptions& lineoptions=FastFileLineOptions())
+{
+    switch( backend ) {
+        case FASTFILE_GETLINE_STDGETLINE:
+            return fastfile_createcore<FastFileStdGetline>( filepath, patterns, engine, lineoptions );
+    #if defined(__unix__)
+        case FASTFILE_GETLINE_POSIXGETLINE:
+            return fastfile_createcore<FastFilePosixGetline>( filepath, patterns, engine, lineoptions );
+        case FASTFILE_GETLINE_MEMORYMAP:
+            return fastfile_createcore<FastFileMemoryMap>( filepath, patterns, engine, lineoptions );
+        case FASTFILE_GETLINE_READAHEAD:
+            return fastfile_createcore<FastFileReadAheadGetline>( filepath, patterns, engine, lineoptions );
+        case FASTFILE_GETLINE_URING:
+            return fastfile_createcore<FastFileUringGetline>( filepath, patterns, engine, lineoptions );
+    #endif
+        default:
+            return new FastFileBuiltins( filepath, lineoptions );
+    }
+}
@@ -0,0 +1,231 @@
+#ifndef FASTFILE_APP_ARENA_H
+#define FASTFILE_APP_ARENA_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#define FASTFILE_ARENA_BLOCKSIZE 262144
+
+/**
+ * The memory of a block, right after this header. While some line on it is pinned, i.e., shared
+ * with Python by a memoryview, the block is not written again. Instead, the arena detaches the
+ * pinned memory from the block, and its last unpin() frees it.
+ */
+struct FastFileArenaBuffer {
+    size_t pins;
+    bool isdetached;
+
+    char* memory() {
+        return reinterpret_cast<char*>( this + 1 );
+    }
+};
+
+struct FastFileArenaBlock {
+    FastFileArenaBuffer* buffer;
+    size_t size;
+    size_t used;
+    size_t lines;
+};
+
+// The high-water marks reported by FastFile::stats()
+struct FastFileArenaStats {
+    size_t mallocs;
+    size_t detached;
+    size_t peakblocks;
+    size_t peakbytes;
+};
+
+/**
+ * A bump allocator for the cached lines bytes. The lines are allocated one after another on the
+ * current block, and each block counts its lines still alive. A block is recycled whole once all
+ * its lines were released, then, after the first few blocks, reading a file does not call malloc().
+ *
+ * A line bigger than a block gets a block of its own size, which is freed instead of recycled.
+ */
+struct FastFileArena {
+    std::vector<FastFileArenaBlock> blocks;
+    std::vector<unsigned int> freeblocks;
+    unsigned int currentblock;
+
+    size_t usedblocks;
+    size_t usedbytes;
+    FastFileArenaStats stats;
+
+    FastFileArena() :
+            currentblock(0),
+            usedblocks(0),
+            usedbytes(0)
+    {
+        stats.mallocs = 0;
+        stats.detached = 0;
+        stats.peakblocks = 0;
+        stats.peakbytes = 0;
+    }
+
+    ~FastFileArena() {
+        clear();
+    }
+
+    // Returns where `size` characters can be written, and on which block, or NULL on failure
+    char* allocate(size_t size, unsigned int& block) {
+        if( blocks.empty() || !_fits( blocks[currentblock], size ) ) {
+            if( !_nextblock( size ) ) {
+                return NULL;
+            }
+        }
+
+        FastFileArenaBlock& arenablock = blocks[currentblock];
+        char* memory = arenablock.buffer->memory() + arenablock.used;
+
+        arenablock.used += size;
+        arenablock.lines += 1;
+        block = currentblock;
+
+        usedbytes += size;
+        stats.peakbytes = std::max( stats.peakbytes, usedbytes );
+        return memory;
+    }
+
+    // Gives back the end of the last line allocated, after only its first `newsize` characters were used
+    void shrink(size_t size, size_t newsize) {
+        blocks[currentblock].used -= size - newsize;
+        usedbytes -= size - newsize;
+    }
+
+    // Releases one line allocated on `block`, recycling the block when it was its last line
+    void release(unsigned int block, size_t size) {
+        FastFileArenaBlock& arenablock = blocks[block];
+        arenablock.lines -= 1;
+        usedbytes -= size;
+
+        // the current block is only rewound later, as the next line goes into it anyway
+        if( arenablock.lines || block == currentblock ) {
+            return;
+        }
+
+        usedblocks -= 1;
+        if( arenablock.size > FASTFILE_ARENA_BLOCKSIZE ) {
+            _freebuffer( arenablock.buffer );
+            arenablock.buffer = NULL;
+            arenablock.size = 0;
+        }
+        freeblocks.push_back( block );
+    }
+
+    // Keeps the memory of a line block alive until unpin(), even after the arena is gone
+    FastFileArenaBuffer* pin(unsigned int block) {
+        FastFileArenaBuffer* buffer = blocks[block].buffer;
+        buffer->pins += 1;
+        return buffer;
+    }
+
+    static void unpin(FastFileArenaBuffer* buffer) {
+        buffer->pins -= 1;
+
+        if( buffer->pins == 0 && buffer->isdetached ) {
+            free( buffer );
+        }
+    }
+
+    void clear() {
+        for( FastFileArenaBlock& arenablock : blocks ) {
+            _freebuffer( arenablock.buffer );
+        }
+
+        blocks.clear();
+        freeblocks.clear();
+        currentblock = 0;
+        usedblocks = 0;
+        usedbytes = 0;
+    }
+
+    void _freebuffer(FastFileArenaBuffer* buffer) {
+        if( buffer == NULL ) {
+            return;
+        }
+
+        if( buffer->pins ) {
+            buffer->isdetached = true;
+            stats.detached += 1;
+        }
+        else {
+            free( buffer );
+        }
+    }
+
+    // Gives `arenablock` unpinned memory with at least `size` characters, it only keeps its current
+    // memory when it is big enough and nobody pinned it
+    bool _renewbuffer(FastFileArenaBlock& arenablock, size_t size) {
+        if( arenablock.buffer && arenablock.size >= size && !arenablock.buffer->pins ) {
+            return true;
+        }
+
+        FastFileArenaBuffer* mallocresult = (FastFileArenaBuffer*) malloc( sizeof(FastFileArenaBuffer) + size );
+
+        if( mallocresult == NULL ) {
+            std::cerr << "ERROR: FastFile failed to alocate a line cache arena block of size '"
+                    << size << "'" << std::endl;
+            return false;
+        }
+
+        mallocresult->pins = 0;
+        mallocresult->isdetached = false;
+
+        _freebuffer( arenablock.buffer );
+        arenablock.buffer = mallocresult;
+        arenablock.size = size;
+        stats.mallocs += 1;
+        return true;
+    }
+
+    // A block without lines is rewound, unless some line on it is still pinned, then, the next lines
+    // still go after the pinned ones, and the block is only given up by _nextblock() when it is full
+    bool _fits(FastFileArenaBlock& arenablock, size_t size) {
+        if( arenablock.lines == 0 && !arenablock.buffer->pins ) {
+            arenablock.used = 0;
+        }
+        return arenablock.used + size <= arenablock.size;
+    }
+
+    // Moves to a free block, or to a new one, leaving the current block to be recycled by release()
+    bool _nextblock(size_t size) {
+        unsigned int newblock;
+        bool isrewinding = !blocks.empty() && blocks[currentblock].lines == 0;
+
+        if( isrewinding ) {
+            newblock = currentblock;
+            usedblocks -= 1;
+        }
+        else if( !freeblocks.empty() ) {
+            newblock = freeblocks.back();
+            freeblocks.pop_back();
+        }
+        else {
+            FastFileArenaBlock arenablock = { NULL, 0, 0, 0 };
+            blocks.push_back( arenablock );
+            newblock = blocks.size() - 1;
+        }
+
+        FastFileArenaBlock& arenablock = blocks[newblock];
+
+        if( !_renewbuffer( arenablock, std::max( size, static_cast<size_t>( FASTFILE_ARENA_BLOCKSIZE ) ) ) ) {
+            if( isrewinding ) {
+                usedblocks += 1;
+            }
+            else {
+                freeblocks.push_back( newblock );
+            }
+            return false;
+        }
+
+        arenablock.used = 0;
+        currentblock = newblock;
+        usedblocks += 1;
+        stats.peakblocks = std::max( stats.peakblocks, usedblocks );
+        return true;
+    }
+};
+
+#endif // FASTFILE_APP_ARENA_H
@@ -0,0 +1,541 @@
+#ifndef FASTFILE_APP_BACKENDS_H
+#define FASTFILE_APP_BACKENDS_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+
+#include "fastfilesimd.h"
+#include "fastfileutf8.h"
+
+#define FASTFILE_GETLINE_DISABLED     0
+#define FASTFILE_GETLINE_STDGETLINE   1
+#define FASTFILE_GETLINE_POSIXGETLINE 2
+#define FASTFILE_GETLINE_MEMORYMAP    3
+#define FASTFILE_GETLINE_READAHEAD    4
+#define FASTFILE_GETLINE_URING        5
+
+#if defined(__unix__)
+    // https://man7.org/linux/man-pages/man2/mmap.2.html
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    #include "fastfilereadahead.h"
+    #include "fastfiledecompressor.h"
+    #include "fastfileuring.h"
+#endif
+
+
+/**
+ * The native file readers, FastFileCore is specialized with one of them. Each one returns the file
+ * lines one by one with next(), without their new line character, and without holding the GIL.
+ *
+ * The lines of the backends with `isstable` stay valid until the next call to release(), while the
+ * others are only valid until the next call to next(). The backends with `istrimmed` already
+ * removed the characters dropped by FASTFILE_TRIMUFT8 when it is enabled.
+ */
+struct FastFileBackend {
+    // With the `follow` keyword, a last line without a new line character is not returned, as it is
+    // still being written, then, after next() returned false, tell() is where this line starts
+    bool isfollowing;
+
+    // Only the read ahead backend reads the compressed files, which cannot be seeked
+    bool iscompressed;
+
+    // The control character kept by the backends with `istrimmed`, see fastfile_trimlinekeeping()
+    int keptcharacter;
+
+    FastFileBackend() :
+            isfollowing(false),
+            iscompressed(false),
+            keptcharacter(FASTFILE_TRIMUFT8_KEEPNONE)
+    {
+    }
+
+    // Called before reading each batch of lines, after all the previous lines were used
+    void release() {
+    }
+
+    // Returns false when next() would have to wait for another thread to read the next line
+    bool isready() {
+        return true;
+    }
+
+    // Each backend has a seek(offset) moving the next line to the start of the line at this file
+    // offset, after release() was called, which is used by FastFile::seekline()
+};
+
+struct FastFileStdGetline : FastFileBackend {
+    static const int backend = FASTFILE_GETLINE_STDGETLINE;
+    static const bool isstable = false;
+    static const bool istrimmed = false;
+
+    std::ifstream fileifstream;
+    char* readline;
+    size_t linebuffersize;
+
+    FastFileStdGetline() :
+            readline(NULL),
+            linebuffersize(0)
+    {
+    }
+
+    bool open(const char* filepath) {
+        linebuffersize = 131072;
+        readline = (char*) malloc( linebuffersize );
+
+        if( readline == NULL ) {
+            std::cerr << "ERROR: FastFile failed to alocate internal line buffer for readline '"
+                    << filepath << "'!" << std::endl;
+            return false;
+        }
+
+        fileifstream.open( filepath );
+
+        if( fileifstream.fail() ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // The line size includes the delimiter extracted by std::getline(), which was replaced by the
+    // null terminator, i.e., the new line character is seen as a '\0' character
+    bool next(const char*& line, size_t& size, bool& hasnewline) {
+        if( fileifstream.eof() ) {
+            return false;
+        }
+
+        fileifstream.getline( readline, linebuffersize );
+
+        if( isfollowing && fileifstream.eof() ) {
+            std::streamsize charsread = fileifstream.gcount();
+            fileifstream.clear();
+            fileifstream.seekg( -charsread, std::ios::cur );
+            return false;
+        }
+
+        // nothing was left after the last new line character
+        if( fileifstream.eof() && fileifstream.gcount() == 0 ) {
+            return false;
+        }
+
+        line = readline;
+        size = fileifstream.gcount();
+        hasnewline = false;
+        return true;
+    }
+
+    uint64_t tell() {
+        fileifstream.clear();
+        return static_cast<uint64_t>( fileifstream.tellg() );
+    }
+
+    bool seek(uint64_t offset) {
+        fileifstream.clear();
+        fileifstream.seekg( offset );
+        return !fileifstream.fail();
+    }
+
+    void close() {
+        if( fileifstream.is_open() ) {
+            fileifstream.close();
+        }
+
+        free( readline );
+        readline = NULL;
+    }
+};
+
+
+#if defined(__unix__)
+struct FastFilePosixGetline : FastFileBackend {
+    static const int backend = FASTFILE_GETLINE_POSIXGETLINE;
+    static const bool isstable = false;
+    static const bool istrimmed = false;
+
+    FILE* cfilestream;
+    char* readline;
+    size_t linebuffersize;
+
+    FastFilePosixGetline() :
+            cfilestream(NULL),
+            readline(NULL),
+            linebuffersize(0)
+    {
+    }
+
+    bool open(const char* filepath) {
+        linebuffersize = 131072;
+        readline = (char*) malloc( linebuffersize );
+
+        if( readline == NULL ) {
+            std::cerr << "ERROR: FastFile failed to alocate internal line buffer for readline '"
+                    << filepath << "'!" << std::endl;
+            return false;
+        }
+
+        cfilestream = fopen( filepath, "r" );
+
+        if( cfilestream == NULL ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool next(const char*& line, size_t& size, bool& hasnewline) {
+        ssize_t charsread = getline( &readline, &linebuffersize, cfilestream );
+
+        if( charsread == -1 ) {
+            return false;
+        }
+
+        hasnewline = charsread && readline[charsread - 1] == '\n';
+
+        if( isfollowing && !hasnewline ) {
+            fseeko( cfilestream, -charsread, SEEK_CUR );
+            return false;
+        }
+
+        line = readline;
+        size = charsread - hasnewline;
+        return true;
+    }
+
+    uint64_t tell() {
+        return ftello( cfilestream );
+    }
+
+    bool seek(uint64_t offset) {
+        clearerr( cfilestream );
+        return fseeko( cfilestream, offset, SEEK_SET ) == 0;
+    }
+
+    void close() {
+        if( cfilestream != NULL ) {
+            fclose( cfilestream );
+            cfilestream = NULL;
+        }
+
+        free( readline );
+        readline = NULL;
+    }
+};
+
+
+// The whole file is mapped read only and the lines are decoded directly from the mapping, they are
+// only copied when a line needs to be compacted by the UTF-8 trimming. The files without a size,
+// as the procfs files, the pipes or `/dev/stdin`, cannot be mapped, then, they are read whole into
+// memory with read(), and used as the mapping.
+struct FastFileMemoryMap : FastFileBackend {
+    static const int backend = FASTFILE_GETLINE_MEMORYMAP;
+    static const bool isstable = true;
+    static const bool istrimmed = false;
+
+    const char* filemapping;
+    const char* mappingcursor;
+    const char* mappingend;
+    size_t mappingsize;
+    bool isread;
+    FastFileScanner newlinescanner;
+
+    FastFileMemoryMap() :
+            filemapping(NULL),
+            mappingcursor(NULL),
+            mappingend(NULL),
+            mappingsize(0),
+            isread(false)
+    {
+    }
+
+    bool open(const char* filepath) {
+        int filedescriptor = ::open( filepath, O_RDONLY );
+
+        if( filedescriptor == -1 ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
+            return false;
+        }
+
+        struct stat filestatus;
+        if( fstat( filedescriptor, &filestatus ) == -1 ) {
+            std::cerr << "ERROR: FastFile failed to get the size of the file '" << filepath << "'!" << std::endl;
+            ::close( filedescriptor );
+            return false;
+        }
+
+        // mmap() does not accept zero length mappings, and the empty files are read to find whether
+        // they are really empty
+        mappingsize = filestatus.st_size;
+        if( !S_ISREG( filestatus.st_mode ) || mappingsize == 0 ) {
+            bool hasread = _readfile( filedescriptor );
+            ::close( filedescriptor );
+
+            if( !hasread ) {
+                std::cerr << "ERROR: FastFile failed to read the file '" << filepath << "' with errno '" << errno << "'!" << std::endl;
+            }
+            return hasread;
+        }
+
+        void* mappingresult = mmap( NULL, mappingsize, PROT_READ, MAP_PRIVATE, filedescriptor, 0 );
+
+        // the mapping keeps its own reference to the file
+        ::close( filedescriptor );
+
+        if( mappingresult == MAP_FAILED ) {
+            std::cerr << "ERROR: FastFile failed to map the file '" << filepath << "' into memory!" << std::endl;
+            mappingsize = 0;
+            return false;
+        }
+
+        // https://man7.org/linux/man-pages/man2/madvise.2.html
+        madvise( mappingresult, mappingsize, MADV_SEQUENTIAL );
+        _setmapping( static_cast<const char*>( mappingresult ) );
+        return true;
+    }
+
+    // Reads the whole file into memory with read(), instead of mapping it
+    bool _readfile(int filedescriptor) {
+        size_t capacity = 65536;
+        char* buffer = static_cast<char*>( malloc( capacity ) );
+        mappingsize = 0;
+
+        while( buffer != NULL ) {
+            if( mappingsize == capacity ) {
+                char* newbuffer = static_cast<char*>( realloc( buffer, capacity * 2 ) );
+
+                if( newbuffer == NULL ) {
+                    break;
+                }
+                buffer = newbuffer;
+                capacity *= 2;
+            }
+
+            ssize_t bytesread = ::read( filedescriptor, buffer + mappingsize, capacity - mappingsize );
+
+            if( bytesread == -1 && errno == EINTR ) {
+                continue;
+            }
+
+            if( bytesread == -1 ) {
+                break;
+            }
+
+            if( bytesread == 0 ) {
+                isread = true;
+                _setmapping( buffer );
+                return true;
+            }
+            mappingsize += bytesread;
+        }
+
+        free( buffer );
+        mappingsize = 0;
+        return false;
+    }
+
+    void _setmapping(const char* mapping) {
+        filemapping = mapping;
+        mappingcursor = filemapping;
+        mappingend = filemapping + mappingsize;
+        newlinescanner.reset( filemapping, mappingsize );
+    }
+
+    bool next(const char*& line, size_t& size, bool& hasnewline) {
+        if( mappingcursor >= mappingend ) {
+            return false;
+        }
+
+        const char* linestart = mappingcursor;
+        const char* lineend = newlinescanner.next();
+
+        if( lineend == NULL ) {
+            if( isfollowing ) {
+                return false;
+            }
+
+            lineend = mappingend;
+            mappingcursor = mappingend;
+            hasnewline = false;
+        }
+        else {
+            mappingcursor = lineend + 1;
+            hasnewline = true;
+        }
+
+        line = linestart;
+        size = lineend - linestart;
+        return true;
+    }
+
+    uint64_t tell() {
+        return filemapping ? mappingcursor - filemapping : 0;
+    }
+
+    bool seek(uint64_t offset) {
+        if( filemapping == NULL ) {
+            return offset == 0;
+        }
+
+        mappingcursor = filemapping + std::min( offset, static_cast<uint64_t>( mappingsize ) );
+        newlinescanner.reset( mappingcursor, mappingend - mappingcursor );
+        return true;
+    }
+
+    void close() {
+        if( filemapping != NULL ) {
+            if( isread ) {
+                free( const_cast<char*>( filemapping ) );
+            }
+            else {
+                munmap( const_cast<char*>( filemapping ), mappingsize );
+            }
+            filemapping = NULL;
+            isread = false;
+            mappingcursor = NULL;
+            mappingend = NULL;
+        }
+    }
+};
+
+
+// The file is read, split and trimmed by the read ahead thread, see fastfilereadahead.h, and a
+// compressed file is decompressed by another thread before, see fastfiledecompressor.h
+struct FastFileReadAheadGetline : FastFileBackend {
+    static const int backend = FASTFILE_GETLINE_READAHEAD;
+    static const bool isstable = true;
+    static const bool istrimmed = FASTFILE_TRIMUFT8 != FASTFILE_TRIMUFT8_DISABLED;
+
+    int filedescriptor;
+    FastFileReadAhead readahead;
+    FastFileDecompressor decompressor;
+
+    // Only used by FastFileUringGetline
+    bool useuring;
+    FastFileUring uring;
+
+    FastFileReadAheadGetline() :
+            filedescriptor(-1),
+            useuring(false)
+    {
+    }
+
+    bool open(const char* filepath) {
+        filedescriptor = ::open( filepath, O_RDONLY );
+
+        if( filedescriptor == -1 ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
+            return false;
+        }
+
+        int compression = fastfile_compression( filepath );
+        if( compression != FASTFILE_COMPRESSION_NONE ) {
+            if( !fastfile_hasdecompressor( compression ) ) {
+                std::cerr << "ERROR: FastFile was built without the " << fastfile_compressionname( compression )
+                        << " library to decompress the file '" << filepath << "'!" << std::endl;
+                return false;
+            }
+
+            if( !decompressor.start( filedescriptor, compression ) ) {
+                std::cerr << "ERROR: FastFile failed to start the decompressor thread for '" << filepath << "'!" << std::endl;
+                return false;
+            }
+
+            iscompressed = true;
+            readahead.source = &decompressor;
+        }
+        else {
+            _startsource();
+        }
+
+        readahead.isfollowing = isfollowing;
+        readahead.keptcharacter = keptcharacter;
+        if( !readahead.start( filedescriptor, FASTFILE_TRIMUFT8 ) ) {
+            std::cerr << "ERROR: FastFile failed to start the read ahead thread for '" << filepath << "'!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Blocks while the read ahead thread did not split the next line
+    bool next(const char*& line, size_t& size, bool& hasnewline) {
+        FastFileSpan span;
+
+        if( !readahead.pop( span ) ) {
+            return false;
+        }
+
+        line = span.line;
+        size = span.size;
+        hasnewline = span.hasnewline;
+        return true;
+    }
+
+    bool isready() {
+        return readahead.isready();
+    }
+
+    uint64_t tell() {
+        return readahead.endoffset;
+    }
+
+    // The read ahead thread is stopped and started again from the new offset
+    bool seek(uint64_t offset) {
+        if( iscompressed ) {
+            return false;
+        }
+        readahead.stop();
+        uring.stop();
+
+        if( lseek( filedescriptor, offset, SEEK_SET ) == -1 ) {
+            std::cerr << "ERROR: FastFile failed to seek the file with errno '" << errno << "'!" << std::endl;
+            return false;
+        }
+
+        _startsource();
+        readahead.keptcharacter = keptcharacter;
+        return readahead.start( filedescriptor, FASTFILE_TRIMUFT8 );
+    }
+
+    // Without io_uring, the read ahead thread reads the file by itself
+    void _startsource() {
+        readahead.source = useuring && uring.start( filedescriptor ) ? &uring : NULL;
+    }
+
+    void release() {
+        readahead.release();
+    }
+
+    // The decompressor stops first, as the read ahead thread can be waiting for it, while io_uring
+    // stops after it, as it is only used by the read ahead thread
+    void close() {
+        decompressor.stop();
+        readahead.stop();
+        uring.stop();
+        readahead.source = NULL;
+
+        if( filedescriptor != -1 ) {
+            ::close( filedescriptor );
+            filedescriptor = -1;
+        }
+    }
+};
+
+
+// The read ahead backend with several reads in flight at once, see fastfileuring.h
+struct FastFileUringGetline : FastFileReadAheadGetline {
+    static const int backend = FASTFILE_GETLINE_URING;
+
+    FastFileUringGetline() {
+        useuring = true;
+    }
+};
+#endif
+
+#endif // FASTFILE_APP_BACKENDS_H
@@ -0,0 +1,424 @@
+#ifndef FASTFILE_APP_COLUMNS_H
+#define FASTFILE_APP_COLUMNS_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "fastfilefields.h"
+
+// The Arrow C data interface structures, as https://arrow.apache.org/docs/format/CDataInterface.html
+// asks to copy them, then, pyarrow and the other Arrow libraries import the columns without copying
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    // Array type description
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray*);
+    // Opaque producer-specific data
+    void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+/**
+ * The fields of one column for a batch of lines, in the Arrow layout: a validity bitmap with a set
+ * bit for each line which has the field, the `int` and `float` fields as 64 bits numbers, and the
+ * `str` and `bytes` fields one after another on `characters`, where the line `n` field goes from
+ * `offsets[n]` up to `offsets[n + 1]`.
+ */
+struct FastFileColumnData {
+    int type;
+    size_t length;
+    size_t nullcount;
+
+    std::vector<uint8_t> validity;
+    std::vector<int64_t> integers;
+    std::vector<double> doubles;
+    std::vector<int64_t> offsets;
+    std::string characters;
+
+    FastFileColumnData(int type) :
+            type(type),
+            length(0),
+            nullcount(0)
+    {
+        offsets.push_back( 0 );
+    }
+
+    bool isnumber() const {
+        return type == FASTFILE_TYPE_INT || type == FASTFILE_TYPE_FLOAT;
+    }
+
+    void appendnull() {
+        _appendvalidity( false );
+
+        switch( type ) {
+            case FASTFILE_TYPE_INT:
+                integers.push_back( 0 );
+                break;
+            case FASTFILE_TYPE_FLOAT:
+                doubles.push_back( 0.0 );
+                break;
+            default:
+                offsets.push_back( characters.size() );
+        }
+    }
+
+    void appendinteger(int64_t integer) {
+        _appendvalidity( true );
+        integers.push_back( integer );
+    }
+
+    void appenddouble(double number) {
+        _appendvalidity( true );
+        doubles.push_back( number );
+    }
+
+    void appendcharacters(const char* start, size_t size) {
+        _appendvalidity( true );
+        characters.append( start, size );
+        offsets.push_back( characters.size() );
+    }
+
+    void _appendvalidity(bool isvalid) {
+        if( length % 8 == 0 ) {
+            validity.push_back( 0 );
+        }
+
+        validity.back() |= static_cast<uint8_t>( isvalid ) << ( length % 8 );
+        nullcount += !isvalid;
+        ++length;
+    }
+
+    // The values buffer, the numbers or the characters
+    const void* values() const {
+        static const char empty[8] = { 0 };
+
+        switch( type ) {
+            case FASTFILE_TYPE_INT:
+                return integers.empty() ? empty : static_cast<const void*>( integers.data() );
+            case FASTFILE_TYPE_FLOAT:
+                return doubles.empty() ? empty : static_cast<const void*>( doubles.data() );
+            default:
+                return characters.empty() ? empty : characters.data();
+        }
+    }
+
+    // The values buffer size in bytes
+    size_t valuessize() const {
+        return isnumber() ? length * 8 : characters.size();
+    }
+
+    // The Arrow format of each type, as 64 bits integers and doubles, and large strings and binaries
+    const char* arrowformat() const {
+        static const char* formats[] = { "U", "Z", "l", "g" };
+        return formats[type];
+    }
+
+    // The buffer protocol format of the values
+    const char* bufferformat() const {
+        static const char* formats[] = { "B", "B", "q", "d" };
+        return formats[type];
+    }
+};
+
+// A column returned by FastFile::readcolumns(), it exports its values with the buffer protocol,
+// `shape` and `strides` are the storage for the exported buffer dimensions
+struct FastFileColumn {
+    PyObject_HEAD
+    FastFileColumnData* data;
+    Py_ssize_t shape;
+    Py_ssize_t strides;
+};
+
+// Exports one of the column buffers with the buffer protocol, keeping the column alive
+struct FastFileColumnView {
+    PyObject_HEAD
+    PyObject* column;
+    const void* buffer;
+    const char* format;
+    Py_ssize_t shape;
+    Py_ssize_t strides;
+};
+
+// The Arrow array `private_data`, the array buffers point into the column kept alive by it
+struct FastFileArrowPrivate {
+    PyObject* column;
+    const void* buffers[3];
+};
+
+// Exports `shape` items of `strides` bytes, `shape` and `strides` live as long as the exporter
+static int fastfile_fillbuffer(PyObject* exporter, Py_buffer* view, int flags, const void* buffer, const char* format,
+        Py_ssize_t* shape, Py_ssize_t* strides)
+{
+    if( PyBuffer_FillInfo( view, exporter, const_cast<void*>( buffer ), *shape * *strides, 1, flags ) ) {
+        return -1;
+    }
+
+    view->itemsize = *strides;
+    view->format = ( flags & PyBUF_FORMAT ) ? const_cast<char*>( format ) : NULL;
+    view->shape = ( flags & PyBUF_ND ) == PyBUF_ND ? shape : NULL;
+    view->strides = ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ? strides : NULL;
+    return 0;
+}
+
+static int fastfile_columngetbuffer(PyObject* exporter, Py_buffer* view, int flags) {
+    FastFileColumn* column = reinterpret_cast<FastFileColumn*>( exporter );
+    return fastfile_fillbuffer( exporter, view, flags, column->data->values(), column->data->bufferformat(),
+            &column->shape, &column->strides );
+}
+
+static int fastfile_columnviewgetbuffer(PyObject* exporter, Py_buffer* view, int flags) {
+    FastFileColumnView* columnview = reinterpret_cast<FastFileColumnView*>( exporter );
+    return fastfile_fillbuffer( exporter, view, flags, columnview->buffer, columnview->format,
+            &columnview->shape, &columnview->strides );
+}
+
+static void fastfile_columndealloc(PyObject* column) {
+    delete reinterpret_cast<FastFileColumn*>( column )->data;
+    Py_TYPE( column )->tp_free( column );
+}
+
+static void fastfile_columnviewdealloc(PyObject* columnview) {
+    Py_DECREF( reinterpret_cast<FastFileColumnView*>( columnview )->column );
+    Py_TYPE( columnview )->tp_free( columnview );
+}
+
+static Py_ssize_t fastfile_columnlength(PyObject* column) {
+    return reinterpret_cast<FastFileColumn*>( column )->data->length;
+}
+
+inline PyTypeObject* fastfile_columnviewtype() {
+    static PyBufferProcs viewbuffer = { fastfile_columnviewgetbuffer, NULL };
+    static PyTypeObject viewtype = { PyVarObject_HEAD_INIT( NULL, 0 ) "fastfilepackage.FastFileColumnView" };
+
+    if( viewtype.tp_basicsize == 0 ) {
+        viewtype.tp_basicsize = sizeof(FastFileColumnView);
+        viewtype.tp_dealloc = fastfile_columnviewdealloc;
+        viewtype.tp_as_buffer = &viewbuffer;
+        viewtype.tp_flags = Py_TPFLAGS_DEFAULT;
+        viewtype.tp_doc = "One of the buffers of a FastFile column";
+    }
+    return &viewtype;
+}
+
+// Returns a new reference to a memoryview over one of the `column` buffers, with `shape` items of
+// `itemsize` bytes
+static PyObject* fastfile_columnbuffer(PyObject* column, const void* buffer, const char* format, Py_ssize_t shape,
+        Py_ssize_t itemsize)
+{
+    FastFileColumnView* columnview = PyObject_New( FastFileColumnView, fastfile_columnviewtype() );
+
+    if( columnview == NULL ) {
+        return NULL;
+    }
+
+    Py_INCREF( column );
+    columnview->column = column;
+    columnview->buffer = buffer;
+    columnview->format = format;
+    columnview->shape = shape;
+    columnview->strides = itemsize;
+
+    // the memoryview keeps the only reference to its column view
+    PyObject* memoryview = PyMemoryView_FromObject( reinterpret_cast<PyObject*>( columnview ) );
+    Py_DECREF( columnview );
+    return memoryview;
+}
+
+static PyObject* fastfile_columnoffsets(PyObject* column, void* closure) {
+    FastFileColumnData* data = reinterpret_cast<FastFileColumn*>( column )->data;
+
+    if( data->isnumber() ) {
+        Py_RETURN_NONE;
+    }
+    return fastfile_columnbuffer( column, data->offsets.data(), "q", data->offsets.size(), 8 );
+}
+
+static PyObject* fastfile_columnvalidity(PyObject* column, void* closure) {
+    FastFileColumnData* data = reinterpret_cast<FastFileColumn*>( column )->data;
+
+    if( data->nullcount == 0 ) {
+        Py_RETURN_NONE;
+    }
+    return fastfile_columnbuffer( column, data->validity.data(), "B", data->validity.size(), 1 );
+}
+
+static PyObject* fastfile_columnnullcount(PyObject* column, void* closure) {
+    return PyLong_FromSize_t( reinterpret_cast<FastFileColumn*>( column )->data->nullcount );
+}
+
+static void fastfile_releaseschema(ArrowSchema* schema) {
+    schema->release = NULL;
+}
+
+// The Arrow consumer may release the array from any thread, without holding the GIL
+static void fastfile_releasearray(ArrowArray* array) {
+    FastFileArrowPrivate* arrowprivate = static_cast<FastFileArrowPrivate*>( array->private_data );
+    PyGILState_STATE state = PyGILState_Ensure();
+
+    Py_DECREF( arrowprivate->column );
+    PyGILState_Release( state );
+
+    delete arrowprivate;
+    array->release = NULL;
+}
+
+static void fastfile_schemacapsuledestructor(PyObject* capsule) {
+    ArrowSchema* schema = static_cast<ArrowSchema*>( PyCapsule_GetPointer( capsule, "arrow_schema" ) );
+
+    if( schema->release != NULL ) {
+        schema->release( schema );
+    }
+    delete schema;
+}
+
+static void fastfile_arraycapsuledestructor(PyObject* capsule) {
+    ArrowArray* array = static_cast<ArrowArray*>( PyCapsule_GetPointer( capsule, "arrow_array" ) );
+
+    if( array->release != NULL ) {
+        array->release( array );
+    }
+    delete array;
+}
+
+// Returns the (schema, array) capsules of the Arrow PyCapsule interface, the `requested_schema`
+// is ignored, as the column is only exported with its own type
+static PyObject* fastfile_columnarrow(PyObject* column, PyObject* args, PyObject* kwargs) {
+    static char* kwlist[] = { const_cast<char*>( "requested_schema" ), NULL };
+    PyObject* requestedschema = Py_None;
+
+    if( !PyArg_ParseTupleAndKeywords( args, kwargs, "|O", kwlist, &requestedschema ) ) {
+        return NULL;
+    }
+
+    FastFileColumnData* data = reinterpret_cast<FastFileColumn*>( column )->data;
+    ArrowSchema* schema = new ArrowSchema();
+    schema->format = data->arrowformat();
+    schema->name = "";
+    schema->flags = ARROW_FLAG_NULLABLE;
+    schema->release = fastfile_releaseschema;
+
+    PyObject* schemacapsule = PyCapsule_New( schema, "arrow_schema", fastfile_schemacapsuledestructor );
+
+    if( schemacapsule == NULL ) {
+        delete schema;
+        return NULL;
+    }
+
+    FastFileArrowPrivate* arrowprivate = new FastFileArrowPrivate();
+    arrowprivate->column = column;
+    arrowprivate->buffers[0] = data->nullcount ? data->validity.data() : NULL;
+    arrowprivate->buffers[1] = data->isnumber() ? data->values() : data->offsets.data();
+    arrowprivate->buffers[2] = data->values();
+    Py_INCREF( column );
+
+    ArrowArray* array = new ArrowArray();
+    array->length = data->length;
+    array->null_count = data->nullcount;
+    array->n_buffers = data->isnumber() ? 2 : 3;
+    array->buffers = arrowprivate->buffers;
+    array->release = fastfile_releasearray;
+    array->private_data = arrowprivate;
+
+    PyObject* arraycapsule = PyCapsule_New( array, "arrow_array", fastfile_arraycapsuledestructor );
+
+    if( arraycapsule == NULL ) {
+        fastfile_releasearray( array );
+        delete array;
+        Py_DECREF( schemacapsule );
+        return NULL;
+    }
+
+    PyObject* capsules = PyTuple_Pack( 2, schemacapsule, arraycapsule );
+    Py_DECREF( schemacapsule );
+    Py_DECREF( arraycapsule );
+    return capsules;
+}
+
+// It is not static, as fastfile_viewtype(), then, PyInit_fastfilepackage() readies the same object
+inline PyTypeObject* fastfile_columntype() {
+    static PyBufferProcs columnbuffer = { fastfile_columngetbuffer, NULL };
+    static PySequenceMethods columnsequence = { fastfile_columnlength };
+
+    static PyMethodDef columnmethods[] = {
+        { "__arrow_c_array__", (PyCFunction) fastfile_columnarrow, METH_VARARGS | METH_KEYWORDS,
+                "Return the Arrow schema and array capsules, which share the column buffers" },
+        { NULL, NULL, 0, NULL }
+    };
+
+    static PyGetSetDef columngetset[] = {
+        { const_cast<char*>( "offsets" ), fastfile_columnoffsets, NULL,
+                const_cast<char*>( "A memoryview with where each field starts on the characters, or None for numbers" ), NULL },
+        { const_cast<char*>( "validity" ), fastfile_columnvalidity, NULL,
+                const_cast<char*>( "A memoryview with the bitmap of the lines with this field, or None without missing fields" ), NULL },
+        { const_cast<char*>( "nullcount" ), fastfile_columnnullcount, NULL,
+                const_cast<char*>( "How many lines do not have this field" ), NULL },
+        { NULL, NULL, NULL, NULL, NULL }
+    };
+
+    static PyTypeObject columntype = { PyVarObject_HEAD_INIT( NULL, 0 ) "fastfilepackage.FastFileColumn" };
+
+    if( columntype.tp_basicsize == 0 ) {
+        columntype.tp_basicsize = sizeof(FastFileColumn);
+        columntype.tp_dealloc = fastfile_columndealloc;
+        columntype.tp_as_buffer = &columnbuffer;
+        columntype.tp_as_sequence = &columnsequence;
+        columntype.tp_methods = columnmethods;
+        columntype.tp_getset = columngetset;
+        columntype.tp_flags = Py_TPFLAGS_DEFAULT;
+        columntype.tp_doc = "The fields of a column for a batch of lines, with the buffer protocol and the Arrow C data interface";
+    }
+    return &columntype;
+}
+
+// Returns a new reference to a column owning `data`, or NULL, deleting `data`
+static PyObject* fastfile_newcolumn(FastFileColumnData* data) {
+    FastFileColumn* column = PyObject_New( FastFileColumn, fastfile_columntype() );
+
+    if( column == NULL ) {
+        delete data;
+        return NULL;
+    }
+
+    column->data = data;
+    column->strides = data->isnumber() ? 8 : 1;
+    column->shape = data->valuessize() / column->strides;
+    return reinterpret_cast<PyObject*>( column );
+}
+
+#endif // FASTFILE_APP_COLUMNS_H
@@ -0,0 +1,841 @@
+#ifndef FASTFILE_APP_DECOMPRESSOR_H
+#define FASTFILE_APP_DECOMPRESSOR_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "fastfilering.h"
+#include "fastfilesource.h"
+#include "fastfileworkers.h"
+
+// The decompression libraries found by setup.py when the module was built
+#if FASTFILE_WITH_ZLIB
+    #include <zlib.h>
+#endif
+
+#if FASTFILE_WITH_ZSTD
+    #include <zstd.h>
+#endif
+
+#if FASTFILE_WITH_LZ4
+    #include <lz4frame.h>
+#endif
+
+#define FASTFILE_COMPRESSION_NONE 0
+#define FASTFILE_COMPRESSION_GZIP 1
+#define FASTFILE_COMPRESSION_ZSTD 2
+#define FASTFILE_COMPRESSION_LZ4  3
+
+// Each worker decompresses frames with at least this many decompressed bytes at once, and a frame
+// bigger than FASTFILE_DECOMPRESSOR_MAXFRAME, or FASTFILE_DECOMPRESSOR_MAXDECODED after being
+// decompressed, is decompressed by a single thread while it is being read
+#define FASTFILE_DECOMPRESSOR_READSIZE   1048576
+#define FASTFILE_DECOMPRESSOR_UNITSIZE   4194304
+#define FASTFILE_DECOMPRESSOR_BLOCKSIZE  1048576
+#define FASTFILE_DECOMPRESSOR_MAXFRAME   8388608
+#define FASTFILE_DECOMPRESSOR_MAXDECODED 33554432
+
+// The decoded bytes all the slots can hold at once, unless a single frame is bigger, then, with many
+// threads, each one decompresses less than FASTFILE_DECOMPRESSOR_UNITSIZE bytes at once
+#define FASTFILE_DECOMPRESSOR_MAXBUFFERED 67108864
+
+#define FASTFILE_DECOMPRESSOR_NEEDMORE    0
+#define FASTFILE_DECOMPRESSOR_UNSPLITTABLE static_cast<size_t>( -1 )
+
+static inline uint32_t fastfile_readle32(const unsigned char* data) {
+    return data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) | ( static_cast<uint32_t>( data[3] ) << 24 );
+}
+
+// Returns the compression format of the file by its first bytes, the file extension is not used
+static inline int fastfile_compression(const char* filepath) {
+    FILE* cfilestream = fopen( filepath, "rb" );
+
+    if( cfilestream == NULL ) {
+        return FASTFILE_COMPRESSION_NONE;
+    }
+
+    unsigned char magic[4] = { 0, 0, 0, 0 };
+    size_t magicsize = fread( magic, 1, sizeof(magic), cfilestream );
+    fclose( cfilestream );
+
+    if( magicsize >= 2 && magic[0] == 0x1f && magic[1] == 0x8b ) {
+        return FASTFILE_COMPRESSION_GZIP;
+    }
+
+    if( magicsize == 4 && fastfile_readle32( magic ) == 0xFD2FB528 ) {
+        return FASTFILE_COMPRESSION_ZSTD;
+    }
+
+    if( magicsize == 4 && fastfile_readle32( magic ) == 0x184D2204 ) {
+        return FASTFILE_COMPRESSION_LZ4;
+    }
+    return FASTFILE_COMPRESSION_NONE;
+}
+
+static inline const char* fastfile_compressionname(int compression) {
+    switch( compression ) {
+        case FASTFILE_COMPRESSION_GZIP: return "gzip";
+        case FASTFILE_COMPRESSION_ZSTD: return "zstd";
+        case FASTFILE_COMPRESSION_LZ4: return "lz4";
+        default: return "none";
+    }
+}
+
+// Returns whether the module was built with the library decompressing this format
+static inline bool fastfile_hasdecompressor(int compression) {
+    switch( compression ) {
+    #if FASTFILE_WITH_ZLIB
+        case FASTFILE_COMPRESSION_GZIP: return true;
+    #endif
+    #if FASTFILE_WITH_ZSTD
+        case FASTFILE_COMPRESSION_ZSTD: return true;
+    #endif
+    #if FASTFILE_WITH_LZ4
+        case FASTFILE_COMPRESSION_LZ4: return true;
+    #endif
+        default: return false;
+    }
+}
+
+
+/**
+ * A streaming decoder of one of the compression formats, which also decodes the following frames,
+ * or gzip members, after the first one ends.
+ */
+struct FastFileInflater {
+    int compression;
+    bool isframeopen;
+
+#if FASTFILE_WITH_ZLIB
+    z_stream zlibstream;
+    bool haszlibstream;
+#endif
+#if FASTFILE_WITH_ZSTD
+    ZSTD_DCtx* zstdcontext;
+#endif
+#if FASTFILE_WITH_LZ4
+    LZ4F_dctx* lz4context;
+#endif
+
+    FastFileInflater() :
+            compression(FASTFILE_COMPRESSION_NONE),
+            isframeopen(false)
+        #if FASTFILE_WITH_ZLIB
+            , haszlibstream(false)
+        #endif
+        #if FASTFILE_WITH_ZSTD
+            , zstdcontext(NULL)
+        #endif
+        #if FASTFILE_WITH_LZ4
+            , lz4context(NULL)
+        #endif
+    {
+    }
+
+    ~FastFileInflater() {
+        close();
+    }
+
+    bool open(int newcompression) {
+        compression = newcompression;
+        isframeopen = false;
+
+        switch( compression ) {
+        #if FASTFILE_WITH_ZLIB
+            case FASTFILE_COMPRESSION_GZIP:
+                if( !haszlibstream ) {
+                    memset( &zlibstream, 0, sizeof(zlibstream) );
+
+                    // 16 makes zlib read the gzip header instead of the zlib one
+                    haszlibstream = inflateInit2( &zlibstream, 16 + MAX_WBITS ) == Z_OK;
+                    return haszlibstream;
+                }
+                return inflateReset( &zlibstream ) == Z_OK;
+        #endif
+        #if FASTFILE_WITH_ZSTD
+            case FASTFILE_COMPRESSION_ZSTD:
+                if( zstdcontext == NULL ) {
+                    zstdcontext = ZSTD_createDCtx();
+                    return zstdcontext != NULL;
+                }
+                return !ZSTD_isError( ZSTD_DCtx_reset( zstdcontext, ZSTD_reset_session_only ) );
+        #endif
+        #if FASTFILE_WITH_LZ4
+            case FASTFILE_COMPRESSION_LZ4:
+                if( lz4context == NULL ) {
+                    return !LZ4F_isError( LZ4F_createDecompressionContext( &lz4context, LZ4F_VERSION ) );
+                }
+                LZ4F_resetDecompressionContext( lz4context );
+                return true;
+        #endif
+            default:
+                return false;
+        }
+    }
+
+    // Decodes from `input` into `output`, adding to `inputused` and `outputused` how much of them
+    // was used. Returns false on corrupted data.
+    bool run(const char* input, size_t inputsize, size_t& inputused, char* output, size_t outputsize, size_t& outputused) {
+        switch( compression ) {
+        #if FASTFILE_WITH_ZLIB
+            case FASTFILE_COMPRESSION_GZIP: {
+                zlibstream.next_in = reinterpret_cast<Bytef*>( const_cast<char*>( input ) );
+                zlibstream.avail_in = static_cast<uInt>( std::min( inputsize, static_cast<size_t>( UINT32_MAX ) ) );
+                zlibstream.next_out = reinterpret_cast<Bytef*>( output );
+                zlibstream.avail_out = static_cast<uInt>( std::min( outputsize, static_cast<size_t>( UINT32_MAX ) ) );
+
+                int result = inflate( &zlibstream, Z_NO_FLUSH );
+                inputused += reinterpret_cast<char*>( zlibstream.next_in ) - input;
+                outputused += reinterpret_cast<char*>( zlibstream.next_out ) - output;
+
+                if( result == Z_STREAM_END ) {
+                    // the next gzip member starts a new stream
+                    isframeopen = false;
+                    return inflateReset( &zlibstream ) == Z_OK;
+                }
+
+                isframeopen = true;
+                return result == Z_OK || result == Z_BUF_ERROR;
+            }
+        #endif
+        #if FASTFILE_WITH_ZSTD
+            case FASTFILE_COMPRESSION_ZSTD: {
+                ZSTD_inBuffer inbuffer = { input, inputsize, 0 };
+                ZSTD_outBuffer outbuffer = { output, outputsize, 0 };
+
+                size_t result = ZSTD_decompressStream( zstdcontext, &outbuffer, &inbuffer );
+                inputused += inbuffer.pos;
+                outputused += outbuffer.pos;
+
+                isframeopen = result != 0;
+                return !ZSTD_isError( result );
+            }
+        #endif
+        #if FASTFILE_WITH_LZ4
+            case FASTFILE_COMPRESSION_LZ4: {
+                size_t insize = inputsize;
+                size_t outsize = outputsize;
+
+                size_t result = LZ4F_decompress( lz4context, output, &outsize, input, &insize, NULL );
+                inputused += insize;
+                outputused += outsize;
+
+                isframeopen = result != 0;
+                return !LZ4F_isError( result );
+            }
+        #endif
+            default:
+                return false;
+        }
+    }
+
+    void close() {
+    #if FASTFILE_WITH_ZLIB
+        if( haszlibstream ) {
+            inflateEnd( &zlibstream );
+            haszlibstream = false;
+        }
+    #endif
+    #if FASTFILE_WITH_ZSTD
+        if( zstdcontext != NULL ) {
+            ZSTD_freeDCtx( zstdcontext );
+            zstdcontext = NULL;
+        }
+    #endif
+    #if FASTFILE_WITH_LZ4
+        if( lz4context != NULL ) {
+            LZ4F_freeDecompressionContext( lz4context );
+            lz4context = NULL;
+        }
+    #endif
+    }
+};
+
+
+// A range of the compressed input with whole frames, and the slot its decoded bytes go into
+struct FastFileCompressedUnit {
+    size_t start;
+    size_t end;
+    size_t decodedsize;
+    unsigned int slot;
+    bool isdecoded;
+};
+
+
+/**
+ * Decompresses a gzip, zstd or lz4 file on a native thread, and read() returns the decompressed
+ * bytes as if they were read from a plain file.
+ *
+ * While the compressed file is made of independent frames, i.e., zstd and lz4 frames, or gzip
+ * members with their size like the BGZF ones written by `bgzip`, `threads` workers decompress
+ * one range of frames each at the same time. Otherwise, like a file written by `gzip` or by a
+ * single `zstd` run, which are a single frame, it is decompressed while it is read, and the worker
+ * threads are never started.
+ *
+ * The decoded blocks go through the `filledslots` ring in the file order, and read() gives them
+ * back on `freeslots` after copying them. The decoding thread waits for them while the slots would
+ * hold more than FASTFILE_DECOMPRESSOR_MAXBUFFERED bytes.
+ */
+struct FastFileDecompressor : FastFileSource {
+    int filedescriptor;
+    int compression;
+    // the workers count, the rings are sized for it, and the decoded bytes of each unit for the slots
+    unsigned int threads;
+    size_t unitsize;
+
+    std::vector<char> input;
+    size_t inputstart;
+    bool isinputfinished;
+
+    std::vector<std::vector<char>> slots;
+    std::vector<size_t> slotsizes;
+    FastFileRing<unsigned int> freeslots;
+    FastFileRing<unsigned int> filledslots;
+
+    // only used by the decoding thread, the slots it holds, and the memory of each slot it knows
+    std::vector<unsigned int> spareslots;
+    std::vector<size_t> slotcapacities;
+    size_t slotsbytes;
+
+    unsigned int currentslot;
+    size_t slotcursor;
+    bool hascurrentslot;
+
+    std::vector<FastFileInflater> inflaters;
+    std::vector<FastFileCompressedUnit> units;
+    FastFileWorkers workers;
+
+    std::thread decoder;
+    bool hasstarted;
+    std::atomic<bool> hasfailed;
+
+    FastFileDecompressor() :
+            filedescriptor(-1),
+            compression(FASTFILE_COMPRESSION_NONE),
+            threads(std::max( std::thread::hardware_concurrency(), 1u )),
+            unitsize(std::min( static_cast<size_t>( FASTFILE_DECOMPRESSOR_UNITSIZE ),
+                    FASTFILE_DECOMPRESSOR_MAXBUFFERED / _slotcount( threads ) )),
+            inputstart(0),
+            isinputfinished(false),
+            freeslots(_slotcount( threads )),
+            filledslots(_slotcount( threads )),
+            slotsbytes(0),
+            currentslot(0),
+            slotcursor(0),
+            hascurrentslot(false),
+            hasstarted(false),
+            hasfailed(false)
+    {
+    }
+
+    ~FastFileDecompressor() {
+        stop();
+    }
+
+    // Each worker needs a free slot for its range, plus the slots being copied and waiting for it
+    static size_t _slotcount(unsigned int threads) {
+        size_t slotcount = 4;
+
+        while( slotcount < 2 * static_cast<size_t>( threads ) + 2 ) {
+            slotcount *= 2;
+        }
+        return slotcount;
+    }
+
+    bool start(int newfiledescriptor, int newcompression) {
+        filedescriptor = newfiledescriptor;
+        compression = newcompression;
+
+        slots.resize( _slotcount( threads ) );
+        slotsizes.resize( slots.size() );
+        slotcapacities.assign( slots.size(), 0 );
+        slotsbytes = 0;
+
+        for( unsigned int slot = 0; slot < slots.size(); ++slot ) {
+            spareslots.push_back( slot );
+        }
+
+        // the other inflaters are only opened with the worker threads
+        inflaters.resize( threads );
+        if( !inflaters[0].open( compression ) ) {
+            std::cerr << "ERROR: FastFile failed to create the " << fastfile_compressionname( compression )
+                    << " decompressor!" << std::endl;
+            return false;
+        }
+
+        decoder = std::thread( &FastFileDecompressor::_decode, this );
+        hasstarted = true;
+        return true;
+    }
+
+    void stop() {
+        if( hasstarted ) {
+            hasstarted = false;
+
+            freeslots.close();
+            filledslots.close();
+            decoder.join();
+        }
+        workers.stop();
+
+        std::vector<std::vector<char>>().swap( slots );
+        std::vector<unsigned int>().swap( spareslots );
+        std::vector<char>().swap( input );
+        inflaters.clear();
+    }
+
+    // Called by the read ahead thread like the read() system call, it returns 0 after the last byte
+    // and -1 when the file could not be decompressed
+    ssize_t read(char* buffer, size_t size) {
+        while( !hascurrentslot || slotcursor == slotsizes[currentslot] ) {
+            if( hascurrentslot ) {
+                freeslots.push( currentslot );
+                hascurrentslot = false;
+            }
+
+            if( !filledslots.pop( currentslot ) ) {
+                if( hasfailed ) {
+                    errno = EIO;
+                    return -1;
+                }
+                return 0;
+            }
+
+            slotcursor = 0;
+            hascurrentslot = true;
+        }
+
+        size_t bytesread = std::min( size, slotsizes[currentslot] - slotcursor );
+        memcpy( buffer, slots[currentslot].data() + slotcursor, bytesread );
+        slotcursor += bytesread;
+        return bytesread;
+    }
+
+    // Appends more compressed bytes to `input`, returning false after the file end
+    bool _readinput() {
+        size_t inputsize = input.size();
+        input.resize( inputsize + FASTFILE_DECOMPRESSOR_READSIZE );
+
+        ssize_t bytesread;
+        do {
+            bytesread = ::read( filedescriptor, input.data() + inputsize, FASTFILE_DECOMPRESSOR_READSIZE );
+        }
+        while( bytesread == -1 && errno == EINTR );
+
+        if( bytesread == -1 ) {
+            std::cerr << "ERROR: FastFile failed to read the compressed file with errno '" << errno << "'!" << std::endl;
+            hasfailed = true;
+        }
+
+        input.resize( inputsize + std::max( bytesread, static_cast<ssize_t>( 0 ) ) );
+        isinputfinished = bytesread <= 0;
+        return !isinputfinished;
+    }
+
+    // Returns the size of the whole frame starting at `data`, FASTFILE_DECOMPRESSOR_NEEDMORE
+    // when it was not read up to its end yet, or FASTFILE_DECOMPRESSOR_UNSPLITTABLE when its size
+    // is only known by decompressing it. `decodedsize` is at least the frame decompressed size.
+    size_t _framesize(const unsigned char* data, size_t size, size_t& decodedsize) {
+        decodedsize = 0;
+
+        if( size >= 8 && ( fastfile_readle32( data ) & 0xFFFFFFF0 ) == 0x184D2A50 ) {
+            // the zstd and lz4 skippable frames have their size after the magic number
+            return _enoughinput( 8 + static_cast<size_t>( fastfile_readle32( data + 4 ) ), size );
+        }
+
+        switch( compression ) {
+            case FASTFILE_COMPRESSION_GZIP: {
+                // the BGZF members have their size on the extra field "BC" subfield
+                if( size < 18 ) {
+                    return _enoughinput( 18, size );
+                }
+
+                if( data[0] != 0x1f || data[1] != 0x8b || !( data[3] & 4 ) ) {
+                    return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+                }
+
+                size_t extraend = 12 + ( data[10] | ( data[11] << 8 ) );
+                if( extraend > size ) {
+                    return _enoughinput( extraend, size );
+                }
+
+                for( size_t field = 12; field + 4 <= extraend; field += 4 + ( data[field + 2] | ( data[field + 3] << 8 ) ) ) {
+                    if( data[field] == 'B' && data[field + 1] == 'C' && ( data[field + 2] | ( data[field + 3] << 8 ) ) == 2 ) {
+                        size_t framesize = _enoughinput( 1 + static_cast<size_t>( data[field + 4] | ( data[field + 5] << 8 ) ), size );
+
+                        // the member ends with its decompressed size
+                        if( framesize != FASTFILE_DECOMPRESSOR_NEEDMORE && framesize != FASTFILE_DECOMPRESSOR_UNSPLITTABLE ) {
+                            decodedsize = fastfile_readle32( data + framesize - 4 );
+                        }
+                        return framesize;
+                    }
+                }
+                return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+            }
+        #if FASTFILE_WITH_ZSTD
+            case FASTFILE_COMPRESSION_ZSTD: {
+                size_t framesize = ZSTD_findFrameCompressedSize( data, size );
+
+                if( ZSTD_isError( framesize ) ) {
+                    return _enoughinput( size + 1, size );
+                }
+
+                // the frames written without their decompressed size are not split
+                unsigned long long contentsize = ZSTD_getFrameContentSize( data, size );
+                if( contentsize == ZSTD_CONTENTSIZE_UNKNOWN || contentsize == ZSTD_CONTENTSIZE_ERROR ) {
+                    return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+                }
+                return _enoughdecoded( framesize, contentsize, decodedsize );
+            }
+        #endif
+            case FASTFILE_COMPRESSION_LZ4:
+                return _lz4framesize( data, size, decodedsize );
+            default:
+                return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+        }
+    }
+
+    // The frames too big to be read before decompressing them are not split
+    size_t _enoughinput(size_t framesize, size_t size) {
+        if( framesize > FASTFILE_DECOMPRESSOR_MAXFRAME || ( framesize > size && isinputfinished ) ) {
+            return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+        }
+        return framesize > size ? FASTFILE_DECOMPRESSOR_NEEDMORE : framesize;
+    }
+
+    // Neither the frames too big to be decompressed at once
+    size_t _enoughdecoded(size_t framesize, uint64_t contentsize, size_t& decodedsize) {
+        if( contentsize > FASTFILE_DECOMPRESSOR_MAXDECODED ) {
+            return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+        }
+
+        decodedsize = static_cast<size_t>( contentsize );
+        return framesize;
+    }
+
+    // https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+    size_t _lz4framesize(const unsigned char* data, size_t size, size_t& decodedsize) {
+        if( size < 15 ) {
+            return _enoughinput( 15, size );
+        }
+
+        unsigned char flags = data[4];
+        size_t position = 4 + 2 + ( flags & 8 ? 8 : 0 ) + ( flags & 1 ? 4 : 0 ) + 1;
+        size_t blockchecksum = flags & 16 ? 4 : 0;
+
+        // without the frame content size, each block decompresses up to the block maximum size
+        uint64_t maximumblocksize = static_cast<uint64_t>( 1 ) << ( 8 + 2 * ( ( data[5] >> 4 ) & 7 ) );
+        uint64_t contentsize = 0;
+
+        while( position + 4 <= size ) {
+            uint32_t blocksize = fastfile_readle32( data + position ) & 0x7FFFFFFF;
+            position += 4;
+
+            if( blocksize == 0 ) {
+                size_t framesize = _enoughinput( position + ( flags & 4 ? 4 : 0 ), size );
+
+                if( framesize == FASTFILE_DECOMPRESSOR_NEEDMORE || framesize == FASTFILE_DECOMPRESSOR_UNSPLITTABLE ) {
+                    return framesize;
+                }
+
+                if( flags & 8 ) {
+                    contentsize = fastfile_readle32( data + 6 ) | static_cast<uint64_t>( fastfile_readle32( data + 10 ) ) << 32;
+                }
+                return _enoughdecoded( framesize, contentsize, decodedsize );
+            }
+
+            position += blocksize + blockchecksum;
+            contentsize += maximumblocksize;
+
+            if( position > FASTFILE_DECOMPRESSOR_MAXFRAME ) {
+                return FASTFILE_DECOMPRESSOR_UNSPLITTABLE;
+            }
+        }
+        return _enoughinput( position + 4, size );
+    }
+
+    // Decodes the compressed units into their slots, each worker takes every `threads` unit
+    void _decodeunits(unsigned int worker) {
+        FastFileInflater& inflater = inflaters[worker];
+
+        for( size_t index = worker; index < units.size(); index += workers.size() ) {
+            FastFileCompressedUnit& unit = units[index];
+            std::vector<char>& slot = slots[unit.slot];
+
+            size_t inputused = 0;
+            size_t outputused = 0;
+            size_t inputsize = unit.end - unit.start;
+            slot.resize( std::max( slot.size(), std::max( unit.decodedsize, static_cast<size_t>( 1 ) ) ) );
+
+            while( inputused < inputsize || inflater.isframeopen ) {
+                if( outputused == slot.size() ) {
+                    slot.resize( slot.size() * 2 );
+                }
+
+                size_t lastinput = inputused;
+                size_t lastoutput = outputused;
+
+                if( !inflater.run( input.data() + unit.start + inputused, inputsize - inputused, inputused,
+                        slot.data() + outputused, slot.size() - outputused, outputused )
+                    || ( inputused == lastinput && outputused == lastoutput ) )
+                {
+                    inflater.open( compression );
+                    unit.isdecoded = false;
+                    break;
+                }
+            }
+
+            slotsizes[unit.slot] = outputused;
+            unit.isdecoded = unit.isdecoded && !inflater.isframeopen;
+        }
+    }
+
+    // Decodes the units found so far with all the workers, and sends their slots in the file order
+    bool _flushunits() {
+        if( units.empty() ) {
+            return true;
+        }
+
+        workers.run( [&]( unsigned int worker ) { _decodeunits( worker ); } );
+
+        for( const FastFileCompressedUnit& unit : units ) {
+            _updatecapacity( unit.slot );
+
+            if( !unit.isdecoded ) {
+                std::cerr << "ERROR: FastFile failed to decompress the " << fastfile_compressionname( compression )
+                        << " file, it is corrupted!" << std::endl;
+                hasfailed = true;
+                return false;
+            }
+
+            if( !filledslots.push( unit.slot ) ) {
+                return false;
+            }
+        }
+
+        filledslots.flush();
+        input.erase( input.begin(), input.begin() + units.back().end );
+        inputstart -= units.back().end;
+        units.clear();
+        return true;
+    }
+
+    // Takes a slot for `decodedsize` bytes. While the slots would hold more than
+    // FASTFILE_DECOMPRESSOR_MAXBUFFERED bytes, the memory of the spare slots is freed, the queued
+    // units are decoded, and the slots still being read are waited for. A bigger unit only gets its
+    // slot after all the others were given back.
+    bool _reserveslot(size_t decodedsize, unsigned int& slot) {
+        decodedsize = std::max( decodedsize, static_cast<size_t>( 1 ) );
+
+        while( true ) {
+            if( !spareslots.empty() ) {
+                slot = spareslots.back();
+
+                if( !_fitsslot( slot, decodedsize ) ) {
+                    _freespareslots( slot );
+                }
+
+                if( _fitsslot( slot, decodedsize ) || spareslots.size() == slots.size() ) {
+                    spareslots.pop_back();
+                    slots[slot].resize( decodedsize );
+                    _updatecapacity( slot );
+                    return true;
+                }
+            }
+
+            if( !units.empty() ) {
+                if( !_flushunits() ) {
+                    return false;
+                }
+                continue;
+            }
+
+            unsigned int freeslot;
+            if( !freeslots.pop( freeslot ) ) {
+                return false;
+            }
+            spareslots.push_back( freeslot );
+        }
+    }
+
+    bool _fitsslot(unsigned int slot, size_t decodedsize) {
+        return slotsbytes - slotcapacities[slot] + std::max( slotcapacities[slot], decodedsize )
+                <= FASTFILE_DECOMPRESSOR_MAXBUFFERED;
+    }
+
+    void _freespareslots(unsigned int keptslot) {
+        for( unsigned int slot : spareslots ) {
+            if( slot != keptslot ) {
+                std::vector<char>().swap( slots[slot] );
+                _updatecapacity( slot );
+            }
+        }
+    }
+
+    void _updatecapacity(unsigned int slot) {
+        slotsbytes = slotsbytes - slotcapacities[slot] + slots[slot].capacity();
+        slotcapacities[slot] = slots[slot].capacity();
+    }
+
+    // Starts the worker threads after finding a second unit of whole frames to decode
+    bool _startworkers() {
+        for( unsigned int worker = 1; worker < threads; ++worker ) {
+            if( !inflaters[worker].open( compression ) ) {
+                std::cerr << "ERROR: FastFile failed to create the " << fastfile_compressionname( compression )
+                        << " decompressor!" << std::endl;
+                hasfailed = true;
+                return false;
+            }
+        }
+
+        workers.start( threads );
+        return true;
+    }
+
+    // Splits the input into units of whole frames for the workers, until some frame size is only
+    // known by decompressing it
+    bool _decodeframes() {
+        while( true ) {
+            if( inputstart == input.size() && isinputfinished ) {
+                return _flushunits();
+            }
+
+            size_t unitstart = inputstart;
+            size_t unitdecodedsize = 0;
+
+            while( unitdecodedsize < unitsize ) {
+                size_t decodedsize;
+                size_t framesize = _framesize( reinterpret_cast<const unsigned char*>( input.data() ) + inputstart,
+                        input.size() - inputstart, decodedsize );
+
+                if( framesize == FASTFILE_DECOMPRESSOR_NEEDMORE ) {
+                    if( !_readinput() && hasfailed ) {
+                        return false;
+                    }
+                    continue;
+                }
+
+                if( framesize == FASTFILE_DECOMPRESSOR_UNSPLITTABLE ) {
+                    break;
+                }
+
+                inputstart += framesize;
+                unitdecodedsize += decodedsize;
+
+                if( inputstart == input.size() && isinputfinished ) {
+                    break;
+                }
+            }
+
+            if( inputstart != unitstart ) {
+                // taking the slot can decode the queued units, moving the unit on `input`
+                size_t unitlength = inputstart - unitstart;
+                unsigned int slot;
+                if( !_reserveslot( unitdecodedsize, slot ) ) {
+                    return false;
+                }
+
+                unitstart = inputstart - unitlength;
+                FastFileCompressedUnit unit = { unitstart, inputstart, unitdecodedsize, slot, true };
+                units.push_back( unit );
+
+                if( units.size() == 2 && workers.size() < threads && !_startworkers() ) {
+                    return false;
+                }
+            }
+
+            if( inputstart == unitstart || units.size() == threads ) {
+                if( !_flushunits() ) {
+                    return false;
+                }
+            }
+
+            // the rest of the file is decompressed while reading it
+            if( inputstart == unitstart ) {
+                return _decodestream();
+            }
+        }
+    }
+
+    // Decompresses the rest of the file with the first inflater into blocks of the same size
+    bool _decodestream() {
+        FastFileInflater& inflater = inflaters[0];
+
+        while( true ) {
+            unsigned int slot;
+            if( !_reserveslot( FASTFILE_DECOMPRESSOR_BLOCKSIZE, slot ) ) {
+                return false;
+            }
+
+            size_t outputused = 0;
+
+            while( outputused < FASTFILE_DECOMPRESSOR_BLOCKSIZE ) {
+                if( inputstart == input.size() ) {
+                    input.clear();
+                    inputstart = 0;
+
+                    if( !_readinput() ) {
+                        break;
+                    }
+                }
+
+                size_t lastinput = inputstart;
+                size_t lastoutput = outputused;
+
+                if( !inflater.run( input.data() + inputstart, input.size() - inputstart, inputstart,
+                        slots[slot].data() + outputused, FASTFILE_DECOMPRESSOR_BLOCKSIZE - outputused, outputused ) )
+                {
+                    std::cerr << "ERROR: FastFile failed to decompress the " << fastfile_compressionname( compression )
+                            << " file, it is corrupted!" << std::endl;
+                    hasfailed = true;
+                    return false;
+                }
+
+                // the decoder needs more input than what is left on the buffer
+                if( inputstart == lastinput && outputused == lastoutput ) {
+                    input.erase( input.begin(), input.begin() + inputstart );
+                    inputstart = 0;
+
+                    if( !_readinput() ) {
+                        break;
+                    }
+                }
+            }
+
+            slotsizes[slot] = outputused;
+            if( !filledslots.push( slot ) ) {
+                return false;
+            }
+
+            if( outputused < FASTFILE_DECOMPRESSOR_BLOCKSIZE ) {
+                if( hasfailed ) {
+                    return false;
+                }
+
+                if( inflater.isframeopen ) {
+                    std::cerr << "ERROR: FastFile failed to decompress the " << fastfile_compressionname( compression )
+                            << " file, it ended before its last frame!" << std::endl;
+                    hasfailed = true;
+                    return false;
+                }
+                return true;
+            }
+        }
+    }
+
+    void _decode() {
+        _decodeframes();
+        filledslots.close();
+    }
+};
+
+#endif // FASTFILE_APP_DECOMPRESSOR_H
@@ -0,0 +1,224 @@
+#ifndef FASTFILE_APP_DEDUP_H
+#define FASTFILE_APP_DEDUP_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#define FASTFILE_DEDUP_NOENTRY static_cast<size_t>( -1 )
+
+// The largest `dedup` capacity accepted, as the entries are grown with the distinct lines seen, a
+// bigger one would only postpone running out of memory
+#define FASTFILE_DEDUP_MAXCAPACITY ( static_cast<size_t>( 1 ) << 24 )
+
+// The buckets count of an empty cache, doubled while there are more entries than half the buckets
+#define FASTFILE_DEDUP_MINBUCKETS 16
+
+// Hashes 16 characters at a time on two independent lanes, it only has to spread the lines over
+// the dedup buckets
+static inline uint64_t fastfile_hashline(const char* line, size_t size) {
+    const uint64_t firstmultiplier = 0x9E3779B97F4A7C15ULL;
+    const uint64_t secondmultiplier = 0xC2B2AE3D27D4EB4FULL;
+
+    uint64_t first = size;
+    uint64_t second = size * firstmultiplier;
+    uint64_t firstword;
+    uint64_t secondword;
+
+    for( ; size >= 16; line += 16, size -= 16 ) {
+        memcpy( &firstword, line, 8 );
+        memcpy( &secondword, line + 8, 8 );
+        first = ( first + firstword ) * firstmultiplier;
+        second = ( second ^ secondword ) * secondmultiplier;
+    }
+
+    firstword = 0;
+    secondword = 0;
+    memcpy( &firstword, line, size > 8 ? 8 : size );
+    if( size > 8 ) {
+        memcpy( &secondword, line + 8, size - 8 );
+    }
+
+    first = ( first + firstword ) * firstmultiplier;
+    second = ( second ^ secondword ) * secondmultiplier;
+
+    uint64_t hash = ( first ^ ( second >> 31 ) ^ ( second << 33 ) ) * firstmultiplier;
+    return hash ^ ( hash >> 32 );
+}
+
+struct FastFileDedupEntry {
+    uint64_t hash;
+    std::string line;
+    PyObject* pythonobject;
+
+    // the next entry on the same bucket, and the neighbours on the recently used list
+    size_t nextinbucket;
+    size_t newer;
+    size_t older;
+};
+
+/**
+ * Remembers the Python objects of the `capacity` most recently returned distinct lines, then, a
+ * line repeated while it is still remembered is not decoded again, but returned as the same object.
+ * The lines are found by their bytes on a chained hash table, and the least recently used line is
+ * forgotten when a new one does not fit.
+ */
+struct FastFileDedup {
+    std::vector<FastFileDedupEntry> entries;
+    std::vector<size_t> buckets;
+    size_t capacity;
+    size_t bucketmask;
+
+    size_t newest;
+    size_t oldest;
+
+    size_t hits;
+    size_t misses;
+
+    FastFileDedup() :
+            capacity(0),
+            bucketmask(0),
+            newest(FASTFILE_DEDUP_NOENTRY),
+            oldest(FASTFILE_DEDUP_NOENTRY),
+            hits(0),
+            misses(0)
+    {
+    }
+
+    ~FastFileDedup() {
+        clear();
+    }
+
+    // A zero capacity disables the cache, the entries and buckets only grow as the lines are inserted
+    void reserve(size_t newcapacity) {
+        capacity = newcapacity;
+        buckets.assign( FASTFILE_DEDUP_MINBUCKETS, FASTFILE_DEDUP_NOENTRY );
+        bucketmask = FASTFILE_DEDUP_MINBUCKETS - 1;
+    }
+
+    bool isenabled() const {
+        return capacity != 0;
+    }
+
+    // Returns a borrowed reference to the object remembered for this line, or NULL
+    PyObject* find(const char* line, size_t size, uint64_t hash) {
+        for( size_t index = buckets[hash & bucketmask]; index != FASTFILE_DEDUP_NOENTRY;
+                index = entries[index].nextinbucket )
+        {
+            FastFileDedupEntry& entry = entries[index];
+
+            if( entry.hash == hash && entry.line.size() == size && memcmp( entry.line.data(), line, size ) == 0 ) {
+                if( index != newest ) {
+                    _unlink( index );
+                    _pushnewest( index );
+                }
+                ++hits;
+                return entry.pythonobject;
+            }
+        }
+
+        ++misses;
+        return NULL;
+    }
+
+    // Remembers a new reference to `pythonobject`, forgetting the least recently used line when full
+    void insert(const char* line, size_t size, uint64_t hash, PyObject* pythonobject) {
+        size_t index;
+
+        if( entries.size() < capacity ) {
+            entries.push_back( FastFileDedupEntry() );
+            index = entries.size() - 1;
+
+            if( entries.size() * 2 > buckets.size() ) {
+                _rehash( buckets.size() * 2 );
+            }
+        }
+        else {
+            index = oldest;
+            _unlink( index );
+            _removefrombucket( index );
+            Py_DECREF( entries[index].pythonobject );
+        }
+
+        FastFileDedupEntry& entry = entries[index];
+        entry.hash = hash;
+        entry.line.assign( line, size );
+        entry.pythonobject = pythonobject;
+        Py_INCREF( pythonobject );
+
+        size_t& bucket = buckets[hash & bucketmask];
+        entry.nextinbucket = bucket;
+        bucket = index;
+        _pushnewest( index );
+    }
+
+    void clear() {
+        for( FastFileDedupEntry& entry : entries ) {
+            Py_DECREF( entry.pythonobject );
+        }
+
+        entries.clear();
+        buckets.assign( buckets.size(), FASTFILE_DEDUP_NOENTRY );
+        newest = FASTFILE_DEDUP_NOENTRY;
+        oldest = FASTFILE_DEDUP_NOENTRY;
+    }
+
+    // Chains the entries again on `bucketcount` buckets, the new entry is not chained yet
+    void _rehash(size_t bucketcount) {
+        buckets.assign( bucketcount, FASTFILE_DEDUP_NOENTRY );
+        bucketmask = bucketcount - 1;
+
+        for( size_t index = 0; index + 1 < entries.size(); ++index ) {
+            size_t& bucket = buckets[entries[index].hash & bucketmask];
+            entries[index].nextinbucket = bucket;
+            bucket = index;
+        }
+    }
+
+    void _pushnewest(size_t index) {
+        FastFileDedupEntry& entry = entries[index];
+        entry.newer = FASTFILE_DEDUP_NOENTRY;
+        entry.older = newest;
+
+        if( newest != FASTFILE_DEDUP_NOENTRY ) {
+            entries[newest].newer = index;
+        }
+        else {
+            oldest = index;
+        }
+        newest = index;
+    }
+
+    void _unlink(size_t index) {
+        FastFileDedupEntry& entry = entries[index];
+
+        if( entry.newer != FASTFILE_DEDUP_NOENTRY ) {
+            entries[entry.newer].older = entry.older;
+        }
+        else {
+            newest = entry.older;
+        }
+
+        if( entry.older != FASTFILE_DEDUP_NOENTRY ) {
+            entries[entry.older].newer = entry.newer;
+        }
+        else {
+            oldest = entry.newer;
+        }
+    }
+
+    void _removefrombucket(size_t index) {
+        size_t* link = &buckets[entries[index].hash & bucketmask];
+
+        while( *link != index ) {
+            link = &entries[*link].nextinbucket;
+        }
+        *link = entries[index].nextinbucket;
+    }
+};
+
+#endif // FASTFILE_APP_DEDUP_H
@@ -0,0 +1,703 @@
+#ifndef FASTFILE_APP_ENGINES_H
+#define FASTFILE_APP_ENGINES_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include "debugger.h"
+
+#define FASTFILE_REGEX_DISABLED  0
+#define FASTFILE_REGEX_C_ENGINE  1
+#define FASTFILE_REGEX_PCRE2     2
+#define FASTFILE_REGEX_RE2       3
+#define FASTFILE_REGEX_HYPERSCAN 4
+
+// Every engine found by setup.py is compiled into the module, and the engine picked by
+// FASTFILE_REGEX is always compiled, as it is the default one
+#if defined(__unix__) && !defined(FASTFILE_WITH_C_ENGINE)
+    #define FASTFILE_WITH_C_ENGINE 1
+#endif
+
+#if FASTFILE_REGEX == FASTFILE_REGEX_PCRE2 && !defined(FASTFILE_WITH_PCRE2)
+    #define FASTFILE_WITH_PCRE2 1
+#endif
+
+#if FASTFILE_REGEX == FASTFILE_REGEX_RE2 && !defined(FASTFILE_WITH_RE2)
+    #define FASTFILE_WITH_RE2 1
+#endif
+
+#if FASTFILE_REGEX == FASTFILE_REGEX_HYPERSCAN && !defined(FASTFILE_WITH_HYPERSCAN)
+    #define FASTFILE_WITH_HYPERSCAN 1
+#endif
+
+#if FASTFILE_WITH_C_ENGINE
+    #include <regex.h>
+#endif
+
+#if FASTFILE_WITH_PCRE2
+    #define PCRE2_CODE_UNIT_WIDTH 8
+    #include <pcre2.h>
+#endif
+
+#if FASTFILE_WITH_RE2
+    #include <re2/re2.h>
+    #include <re2/set.h>
+#endif
+
+#if FASTFILE_WITH_HYPERSCAN
+    #include <hs.h>
+#endif
+
+
+// A line already read and trimmed without holding the GIL, it lives on the batch buffer or, when the
+// backend lines stay valid after reading the next ones, directly where the backend read it
+struct FastFileBatchLine {
+    size_t offset;
+    size_t size;
+    const char* mappedline;
+    bool hasnewline;
+    bool hasmatched;
+
+    const char* start(const char* batchbuffer) const {
+        return mappedline ? mappedline : batchbuffer + offset;
+    }
+};
+
+
+/**
+ * The parts shared by all the regex engines. FastFileCore only calls the methods of the engine it
+ * was specialized with, then, each engine hides the methods here it does better.
+ *
+ * The lines given to match() are not null terminated, and match() can be called at the same time
+ * by several threads, as long as each one uses its own `worker` index, see reserve().
+ */
+struct FastFileEngine {
+    const char* filepath;
+    bool hasinitializedmonsterregex;
+
+    FastFileEngine() :
+            filepath(NULL),
+            hasinitializedmonsterregex(false)
+    {
+    }
+
+    // Several patterns are joined as alternatives of a single regex for the engines without sets
+    static std::string _joinpatterns(const std::vector<std::string>& patterns, const char* groupstart) {
+        if( patterns.size() == 1 ) {
+            return patterns[0];
+        }
+        std::string joinedregex;
+
+        for( const std::string& pattern : patterns ) {
+            if( joinedregex.size() ) {
+                joinedregex += "|";
+            }
+            joinedregex += groupstart + pattern + ")";
+        }
+        return joinedregex;
+    }
+
+    // Creates whatever each one of the `workercount` threads needs for matching at the same time
+    bool reserve(unsigned int workercount) {
+        return true;
+    }
+
+    // Matches the lines `firstline` up to `lastline` with a single call over the memory holding all of
+    // them one after another, either on the batch buffer or where the backend read them, returning
+    // false when this engine can only match one line at a time
+    bool scanbuffer(const char* buffer, std::vector<FastFileBatchLine>& batchlines,
+            size_t firstline, size_t lastline, bool withnewlines, unsigned int worker)
+    {
+        return false;
+    }
+
+    void _matcherror(int returncode, const char* line, size_t size) {
+        std::cerr << "ERROR: FastFile match failed the following returncode='"
+                << returncode << "' file='"
+                << filepath << "' line='" << std::string( line, size ) << "'!" << std::endl;
+    }
+};
+
+
+// Used when there is no regex, every line matches
+struct FastFileNoEngine : FastFileEngine {
+    static const int engine = FASTFILE_REGEX_DISABLED;
+
+    bool compile(const char* newfilepath, const std::vector<std::string>& patterns) {
+        filepath = newfilepath;
+        return true;
+    }
+
+    bool match(const char* line, size_t size, unsigned int worker) {
+        return true;
+    }
+
+    void patternids(const char* line, size_t size, std::vector<int>& matchedids) {
+    }
+
+    void close() {
+    }
+};
+
+
+#if FASTFILE_WITH_C_ENGINE
+// https://linux.die.net/man/3/regexec
+// with several patterns, `monsterregex` matches any of them and `patternregexes` has each one of
+// them compiled alone, only for finding which ones matched on patternids(). As glibc regexec() holds
+// a lock of the compiled regex while matching, each other worker has its own copy on `workerregexes`.
+struct FastFileCEngine : FastFileEngine {
+    static const int engine = FASTFILE_REGEX_C_ENGINE;
+
+    std::string rawregex;
+    regex_t monsterregex;
+    std::vector<regex_t> workerregexes;
+    std::vector<regex_t> patternregexes;
+
+    bool compile(const char* newfilepath, const std::vector<std::string>& patterns) {
+        filepath = newfilepath;
+        rawregex = _joinpatterns( patterns, "(" );
+        int rawresultregex = regcomp( &monsterregex, rawregex.c_str(), REG_NOSUB | REG_EXTENDED );
+
+        if( rawresultregex ) {
+            std::cerr << "ERROR: FastFile failed to compile rawregex for '"
+                    << filepath << " & " << rawregex << ", error==" << rawresultregex << "'!" << std::endl;
+            return false;
+        }
+        hasinitializedmonsterregex = true;
+
+        for( size_t index = 0; patterns.size() > 1 && index < patterns.size(); ++index ) {
+            regex_t patternregex;
+            rawresultregex = regcomp( &patternregex, patterns[index].c_str(), REG_NOSUB | REG_EXTENDED );
+
+            if( rawresultregex ) {
+                std::cerr << "ERROR: FastFile failed to compile the pattern for '"
+                        << filepath << " & " << patterns[index] << ", error==" << rawresultregex << "'!" << std::endl;
+                return false;
+            }
+            patternregexes.push_back( patternregex );
+        }
+        return true;
+    }
+
+    // The worker zero uses `monsterregex`
+    bool reserve(unsigned int workercount) {
+        while( workerregexes.size() + 1 < workercount ) {
+            regex_t workerregex;
+
+            if( regcomp( &workerregex, rawregex.c_str(), REG_NOSUB | REG_EXTENDED ) ) {
+                return false;
+            }
+            workerregexes.push_back( workerregex );
+        }
+        return true;
+    }
+
+    // REG_STARTEND takes the line size from the first match, instead of looking for its null terminator
+    static int _regexec(const regex_t* regex, const char* line, size_t size) {
+        regmatch_t linebounds[1];
+        linebounds[0].rm_so = 0;
+        linebounds[0].rm_eo = size;
+        return regexec( regex, line, 1, linebounds, REG_STARTEND );
+    }
+
+    bool match(const char* line, size_t size, unsigned int worker) {
+        int returncode = _regexec( worker ? &workerregexes[worker - 1] : &monsterregex, line, size );
+
+        if( returncode != REG_NOMATCH ) {
+            return true;
+        }
+
+        LOG( 1, "regexresult: %s line %p size %d '%s'", returncode, line, size, std::string( line, size ) );
+        return false;
+    }
+
+    void patternids(const char* line, size_t size, std::vector<int>& matchedids) {
+        if( patternregexes.empty() && match( line, size, 0 ) ) {
+            matchedids.push_back( 0 );
+        }
+
+        for( size_t index = 0; index < patternregexes.size(); ++index ) {
+            if( _regexec( &patternregexes[index], line, size ) != REG_NOMATCH ) {
+                matchedids.push_back( index );
+            }
+        }
+    }
+
+    void close() {
+        if( hasinitializedmonsterregex ) {
+            hasinitializedmonsterregex = false;
+            regfree( &monsterregex );
+        }
+
+        for( regex_t& workerregex : workerregexes ) {
+            regfree( &workerregex );
+        }
+        workerregexes.clear();
+
+        for( regex_t& patternregex : patternregexes ) {
+            regfree( &patternregex );
+        }
+        patternregexes.clear();
+    }
+};
+#endif
+
+
+#if FASTFILE_WITH_PCRE2
+// http://pcre.org/current/doc/html/pcre2_match.html
+// each worker needs its own match data
+struct FastFilePcre2Engine : FastFileEngine {
+    static const int engine = FASTFILE_REGEX_PCRE2;
+
+    pcre2_code* monsterregex;
+    std::vector<pcre2_code*> patternregexes;
+    std::vector<pcre2_match_data*> workers_match_data;
+
+    FastFilePcre2Engine() :
+            monsterregex(NULL)
+    {
+    }
+
+    bool compile(const char* newfilepath, const std::vector<std::string>& patterns) {
+        filepath = newfilepath;
+        std::string rawregex = _joinpatterns( patterns, "(?:" );
+
+        int errorcode;
+        PCRE2_SIZE erroffset;
+
+        workers_match_data.push_back( pcre2_match_data_create( 1, NULL ) );
+        monsterregex = pcre2_compile( reinterpret_cast<PCRE2_SPTR>( rawregex.c_str() ),
+                PCRE2_ZERO_TERMINATED, PCRE2_UTF, &errorcode, &erroffset, NULL );
+
+        if( monsterregex == NULL ) {
+            PCRE2_UCHAR8 errorbuffer[1024];
+            int errormessageresult = pcre2_get_error_message( errorcode, errorbuffer, sizeof( errorbuffer ) );
+
+            std::cerr << "ERROR: FastFile failed to compile rawregex for '"
+                    << filepath << " & " << rawregex;
+
+            if( errormessageresult < 1 ) {
+                    std::cerr << ", error==" << errorcode;
+            }
+            else {
+                std::cerr << ", error==" << errorcode << ", " << errorbuffer;
+            }
+
+            std::cerr << ", on position==" << erroffset << "'!" << std::endl;
+            return false;
+        }
+        hasinitializedmonsterregex = true;
+
+        for( size_t index = 0; patterns.size() > 1 && index < patterns.size(); ++index ) {
+            pcre2_code* patternregex = pcre2_compile( reinterpret_cast<PCRE2_SPTR>( patterns[index].c_str() ),
+                    PCRE2_ZERO_TERMINATED, PCRE2_UTF, &errorcode, &erroffset, NULL );
+
+            if( patternregex == NULL ) {
+                std::cerr << "ERROR: FastFile failed to compile the pattern for '"
+                        << filepath << " & " << patterns[index] << ", error==" << errorcode
+                        << ", on position==" << erroffset << "'!" << std::endl;
+                return false;
+            }
+            patternregexes.push_back( patternregex );
+        }
+        return true;
+    }
+
+    bool reserve(unsigned int workercount) {
+        while( workers_match_data.size() < workercount ) {
+            workers_match_data.push_back( pcre2_match_data_create( 1, NULL ) );
+        }
+        return true;
+    }
+
+    bool match(const char* line, size_t size, unsigned int worker) {
+        int returncode = pcre2_match( monsterregex, reinterpret_cast<PCRE2_SPTR>( line ),
+                size, 0, PCRE2_NO_UTF_CHECK, workers_match_data[worker], NULL );
+
+        if( returncode > -1 ) {
+            return true;
+        }
+
+        if( returncode < -2 ) {
+            _matcherror( returncode, line, size );
+        }
+
+        LOG( 1, "regexresult: %s line %p size %d '%s'", returncode, line, size, std::string( line, size ) );
+        return false;
+    }
+
+    void patternids(const char* line, size_t size, std::vector<int>& matchedids) {
+        if( patternregexes.empty() && match( line, size, 0 ) ) {
+            matchedids.push_back( 0 );
+        }
+
+        for( size_t index = 0; index < patternregexes.size(); ++index ) {
+            if( pcre2_match( patternregexes[index], reinterpret_cast<PCRE2_SPTR>( line ),
+                    size, 0, PCRE2_NO_UTF_CHECK, workers_match_data[0], NULL ) > -1 )
+            {
+                matchedids.push_back( index );
+            }
+        }
+    }
+
+    void close() {
+        hasinitializedmonsterregex = false;
+        pcre2_code_free( monsterregex );
+        monsterregex = NULL;
+
+        for( pcre2_code* patternregex : patternregexes ) {
+            pcre2_code_free( patternregex );
+        }
+        patternregexes.clear();
+
+        for( pcre2_match_data* worker_match_data : workers_match_data ) {
+            pcre2_match_data_free( worker_match_data );
+        }
+        workers_match_data.clear();
+    }
+};
+#endif
+
+
+#if FASTFILE_WITH_RE2
+// https://github.com/google/re2/wiki/CplusplusAPI
+// with several patterns, they are all matched at once by `monsterset` instead
+struct FastFileRe2Engine : FastFileEngine {
+    static const int engine = FASTFILE_REGEX_RE2;
+
+    RE2* monsterregex;
+    RE2::Set* monsterset;
+    RE2::Options myglobaloptions;
+
+    FastFileRe2Engine() :
+            monsterregex(NULL),
+            monsterset(NULL)
+    {
+    }
+
+    bool compile(const char* newfilepath, const std::vector<std::string>& patterns) {
+        filepath = newfilepath;
+
+        // myglobaloptions.set_posix_syntax(true);
+        if( patterns.size() > 1 ) {
+            monsterset = new RE2::Set( myglobaloptions, RE2::UNANCHORED );
+
+            for( const std::string& pattern : patterns ) {
+                std::string error;
+
+                if( monsterset->Add( pattern, &error ) < 0 ) {
+                    std::cerr << "ERROR: FastFile failed to compile the pattern for '"
+                            << filepath << " & " << pattern << ", error==" << error << "'!" << std::endl;
+                    return false;
+                }
+            }
+
+            if( !monsterset->Compile() ) {
+                std::cerr << "ERROR: FastFile failed to compile rawregex for '"
+                        << filepath << " & " << _joinpatterns( patterns, "(?:" ) << ", error==out of memory'!" << std::endl;
+                return false;
+            }
+        }
+        else {
+            monsterregex = new RE2( patterns[0], myglobaloptions );
+
+            if( !monsterregex->ok() ) {
+                std::cerr << "ERROR: FastFile failed to compile rawregex for '"
+                        << filepath << " & " << patterns[0]
+                        << ", error==" << monsterregex->error() << "'!" << std::endl;
+                return false;
+            }
+        }
+        hasinitializedmonsterregex = true;
+        return true;
+    }
+
+    bool match(const char* line, size_t size, unsigned int worker) {
+        re2::StringPiece readline( line, size );
+        bool returncode = monsterset ? monsterset->Match( readline, NULL ) : RE2::PartialMatch( readline, *monsterregex );
+
+        if( returncode ) {
+            return true;
+        }
+
+        LOG( 1, "regexresult: %s line %p size %d '%s'", returncode, line, size, std::string( line, size ) );
+        return false;
+    }
+
+    void patternids(const char* line, size_t size, std::vector<int>& matchedids) {
+        if( monsterset ) {
+            monsterset->Match( re2::StringPiece( line, size ), &matchedids );
+            std::sort( matchedids.begin(), matchedids.end() );
+        }
+        else if( match( line, size, 0 ) ) {
+            matchedids.push_back( 0 );
+        }
+    }
+
+    void close() {
+        hasinitializedmonsterregex = false;
+        delete monsterregex;
+        delete monsterset;
+        monsterregex = NULL;
+        monsterset = NULL;
+    }
+};
+#endif
+
+
+#if FASTFILE_WITH_HYPERSCAN
+// The slice of the batch being scanned by one Hyperscan call
+struct FastFileBufferMatch {
+    std::vector<FastFileBatchLine>* batchlines;
+    size_t firstline;
+    size_t lastline;
+    const char* batchbuffer;
+    const char* scanstart;
+    bool withnewlines;
+
+    // the lines where a match starting on an earlier line ends, to be matched again on their own
+    std::vector<size_t> recheckedlines;
+};
+
+// https://github.com/intel/hyperscan
+// with several patterns, `monsterregex` is a multi pattern database using their indexes as ids,
+// and each worker needs its own scratch space
+struct FastFileHyperscanEngine : FastFileEngine {
+    static const int engine = FASTFILE_REGEX_HYPERSCAN;
+
+    hs_database_t* monsterregex;
+    std::vector<hs_scratch_t*> workersscratchspace;
+
+    // the same regex compiled for scanning the whole batch buffer, NULL when the regex is not
+    // supported by this mode, and each line is matched by `monsterregex`
+    hs_database_t* bufferregex;
+
+    FastFileHyperscanEngine() :
+            monsterregex(NULL),
+            bufferregex(NULL)
+    {
+    }
+
+    bool compile(const char* newfilepath, const std::vector<std::string>& patterns) {
+        filepath = newfilepath;
+        std::string rawregex = _joinpatterns( patterns, "(?:" );
+
+        hs_compile_error_t *compile_err;
+        hs_scratch_t *scratchspace = NULL;
+        std::vector<const char*> expressions;
+        std::vector<unsigned int> expressionsflags;
+        std::vector<unsigned int> expressionsids;
+
+        for( size_t index = 0; index < patterns.size(); ++index ) {
+            expressions.push_back( patterns[index].c_str() );
+            expressionsflags.push_back( HS_FLAG_SINGLEMATCH | HS_FLAG_DOTALL );
+            expressionsids.push_back( index );
+        }
+
+        if( hs_compile_multi( expressions.data(), expressionsflags.data(), expressionsids.data(),
+                       expressions.size(), HS_MODE_BLOCK, NULL, &monsterregex, &compile_err ) != HS_SUCCESS )
+        {
+            std::cerr << "ERROR: FastFile failed to compile rawregex for '"
+                    << filepath << " & " << rawregex
+                    << ", error==" << compile_err->message << "'!" << std::endl;
+            hs_free_compile_error( compile_err );
+            monsterregex = NULL;
+            return false;
+        }
+        hasinitializedmonsterregex = true;
+
+        if( hs_alloc_scratch( monsterregex, &scratchspace ) != HS_SUCCESS ) {
+            std::cerr << "ERROR: FastFile failed to allocate scratch space for '"
+                    << filepath << " & " << rawregex << "'!" << std::endl;
+            return false;
+        }
+        workersscratchspace.push_back( scratchspace );
+
+    #if FASTFILE_REGEXBUFFER
+        // the matches must not cross the line boundaries and their start offset is required to
+        // find the line they are on, i.e., `.` cannot match a new line anymore
+        for( unsigned int& expressionflags : expressionsflags ) {
+            expressionflags = HS_FLAG_MULTILINE | HS_FLAG_SOM_LEFTMOST;
+        }
+
+        if( hs_compile_multi( expressions.data(), expressionsflags.data(), expressionsids.data(),
+                       expressions.size(), HS_MODE_BLOCK, NULL, &bufferregex, &compile_err ) != HS_SUCCESS )
+        {
+            LOG( 1, "Matching each line because the rawregex cannot scan the whole buffer '%s', error==%s",
+                    rawregex, compile_err->message );
+            hs_free_compile_error( compile_err );
+            bufferregex = NULL;
+        }
+        else if( hs_alloc_scratch( bufferregex, &workersscratchspace[0] ) != HS_SUCCESS ) {
+            std::cerr << "ERROR: FastFile failed to allocate scratch space for '"
+                    << filepath << " & " << rawregex << "'!" << std::endl;
+            return false;
+        }
+    #endif
+        return true;
+    }
+
+    bool reserve(unsigned int workercount) {
+        while( workersscratchspace.size() < workercount ) {
+            hs_scratch_t* workerscratchspace = NULL;
+
+            if( hs_clone_scratch( workersscratchspace[0], &workerscratchspace ) != HS_SUCCESS ) {
+                std::cerr << "ERROR: FastFile failed to allocate the worker scratch space for '"
+                        << filepath << "'!" << std::endl;
+                return false;
+            }
+            workersscratchspace.push_back( workerscratchspace );
+        }
+        return true;
+    }
+
+    static int HS_CDECL _onanymatch(
+            unsigned int id,
+            unsigned long long from,
+            unsigned long long to,
+            unsigned int flags,
+            void* context)
+    {
+        return 1;
+    }
+
+    bool match(const char* line, size_t size, unsigned int worker) {
+        int returncode = hs_scan( monsterregex, line, size, 0, workersscratchspace[worker], &FastFileHyperscanEngine::_onanymatch, NULL );
+
+        if( returncode == HS_SCAN_TERMINATED ) {
+            return true;
+        }
+
+        if( returncode < 0 ) {
+            _matcherror( returncode, line, size );
+        }
+
+        LOG( 1, "regexresult: %s line %p size %d '%s'", returncode, line, size, std::string( line, size ) );
+        return false;
+    }
+
+    bool scanbuffer(const char* buffer, std::vector<FastFileBatchLine>& batchlines,
+            size_t firstline, size_t lastline, bool withnewlines, unsigned int worker)
+    {
+        if( bufferregex == NULL ) {
+            return false;
+        }
+
+        if( firstline == lastline ) {
+            return true;
+        }
+
+        // the lines are only marked as matched after finding a match starting and ending on them
+        for( size_t index = firstline; index < lastline; ++index ) {
+            batchlines[index].hasmatched = false;
+        }
+
+        // the batch buffer always has a new line character after its last line, unlike a mapped file end
+        const FastFileBatchLine& lastbatchline = batchlines[lastline - 1];
+        const char* scanstart = batchlines[firstline].start( buffer );
+        const char* scanend = lastbatchline.start( buffer ) + lastbatchline.size
+                + ( !lastbatchline.mappedline || lastbatchline.hasnewline );
+
+        FastFileBufferMatch buffermatch = { &batchlines, firstline, lastline, buffer, scanstart, withnewlines,
+                std::vector<size_t>() };
+
+        int returncode = hs_scan( bufferregex, scanstart, scanend - scanstart, 0,
+                workersscratchspace[worker], &FastFileHyperscanEngine::_onbuffermatch, &buffermatch );
+
+        if( returncode != HS_SUCCESS ) {
+            _matcherror( returncode, "", 0 );
+        }
+
+        // the scratch space is only free again after hs_scan() returns
+        for( size_t index : buffermatch.recheckedlines ) {
+            FastFileBatchLine& batchline = batchlines[index];
+
+            if( !batchline.hasmatched ) {
+                batchline.hasmatched = match( batchline.start( buffer ),
+                        batchline.size + ( withnewlines && batchline.hasnewline ), worker );
+            }
+        }
+        return true;
+    }
+
+    // Called by Hyperscan for each match on the scanned lines, the offsets are relative to the first
+    // line start, and the matches come sorted by their end offset
+    static int HS_CDECL _onbuffermatch(
+            unsigned int id,
+            unsigned long long from,
+            unsigned long long to,
+            unsigned int flags,
+            void* context)
+    {
+        FastFileBufferMatch* buffermatch = static_cast<FastFileBufferMatch*>( context );
+        std::vector<FastFileBatchLine>& batchlines = *buffermatch->batchlines;
+
+        const char* batchbuffer = buffermatch->batchbuffer;
+        const char* matchstart = buffermatch->scanstart + from;
+        const char* matchend = buffermatch->scanstart + to;
+
+        // the match is on the last line starting before it
+        std::vector<FastFileBatchLine>::iterator batchline = std::upper_bound(
+                batchlines.begin() + buffermatch->firstline, batchlines.begin() + buffermatch->lastline, matchstart,
+                [batchbuffer]( const char* start, const FastFileBatchLine& line ) { return start < line.start( batchbuffer ); } ) - 1;
+
+        // without the UTF-8 trimming, a per line match also would see the line new line character
+        if( matchend <= batchline->start( batchbuffer ) + batchline->size + ( buffermatch->withnewlines && batchline->hasnewline ) ) {
+            batchline->hasmatched = true;
+            return 0;
+        }
+
+        // with a pattern matching new lines, e.g., `\s*ERROR`, only the leftmost start is reported for
+        // each match end, and it can hide a match starting on the same line where this one ends
+        size_t endindex = std::upper_bound(
+                batchlines.begin() + buffermatch->firstline, batchlines.begin() + buffermatch->lastline, matchend - 1,
+                [batchbuffer]( const char* start, const FastFileBatchLine& line ) { return start < line.start( batchbuffer ); } )
+                - batchlines.begin() - 1;
+
+        std::vector<size_t>& recheckedlines = buffermatch->recheckedlines;
+        if( !batchlines[endindex].hasmatched && ( recheckedlines.empty() || recheckedlines.back() != endindex ) ) {
+            recheckedlines.push_back( endindex );
+        }
+        return 0;
+    }
+
+    static int HS_CDECL _onpatternid(
+            unsigned int id,
+            unsigned long long from,
+            unsigned long long to,
+            unsigned int flags,
+            void* context)
+    {
+        static_cast<std::vector<int>*>( context )->push_back( id );
+        return 0;
+    }
+
+    void patternids(const char* line, size_t size, std::vector<int>& matchedids) {
+        int returncode = hs_scan( monsterregex, line, size, 0, workersscratchspace[0],
+                &FastFileHyperscanEngine::_onpatternid, &matchedids );
+        std::sort( matchedids.begin(), matchedids.end() );
+
+        if( returncode != HS_SUCCESS ) {
+            _matcherror( returncode, line, size );
+        }
+    }
+
+    void close() {
+        hasinitializedmonsterregex = false;
+
+        for( hs_scratch_t* workerscratchspace : workersscratchspace ) {
+            hs_free_scratch( workerscratchspace );
+        }
+        workersscratchspace.clear();
+
+        hs_free_database( monsterregex );
+        hs_free_database( bufferregex );
+        monsterregex = NULL;
+        bufferregex = NULL;
+    }
+};
+#endif
+
+#endif // FASTFILE_APP_ENGINES_H
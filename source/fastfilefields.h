@@ -0,0 +1,224 @@
+#ifndef FASTFILE_APP_FIELDS_H
+#define FASTFILE_APP_FIELDS_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "fastfilesimd.h"
+
+// The Python objects created for each field, picked with the `types` keyword
+#define FASTFILE_TYPE_STR   0
+#define FASTFILE_TYPE_BYTES 1
+#define FASTFILE_TYPE_INT   2
+#define FASTFILE_TYPE_FLOAT 3
+
+// The fields() arguments, without `columns`, each line becomes a tuple with all its fields, and
+// without `types`, the fields are `str` or `bytes` as the lines `mode`, otherwise, there is one type
+// for each column
+struct FastFileFieldOptions {
+    char delimiter;
+    char quote;
+    bool hasquote;
+    std::vector<size_t> columns;
+    std::vector<int> types;
+
+    FastFileFieldOptions() :
+            delimiter(','),
+            quote('"'),
+            hasquote(false)
+    {
+    }
+};
+
+// A field of a line, without its quotes, `isescaped` when it still has some doubled quote inside it
+struct FastFileField {
+    const char* start;
+    size_t size;
+    bool isescaped;
+};
+
+// Returns the mask with the bits set from each odd set bit up to the next set bit, i.e., the bytes
+// inside quotes for a mask of quote characters, counting the opening quote, but not the closing one
+static inline uint64_t fastfile_prefixxor64( uint64_t mask ) {
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+// Parses a decimal integer with optional spaces around it and an optional sign, returning false
+// when it is not one, or when it does not fit in 64 bits
+static inline bool fastfile_parseinteger(const char* start, size_t size, int64_t& value) {
+    const char* end = start + size;
+
+    while( start < end && start[0] == ' ' ) {
+        ++start;
+    }
+
+    while( start < end && end[-1] == ' ' ) {
+        --end;
+    }
+
+    bool isnegative = start < end && start[0] == '-';
+    start += start < end && ( start[0] == '-' || start[0] == '+' );
+
+    // 18 digits always fit, the longer numbers are left to PyLong_FromString()
+    if( start == end || end - start > 18 ) {
+        return false;
+    }
+
+    uint64_t absolute = 0;
+    for( ; start < end; ++start ) {
+        unsigned int digit = static_cast<unsigned char>( *start ) - '0';
+
+        if( digit > 9 ) {
+            return false;
+        }
+        absolute = absolute * 10 + digit;
+    }
+
+    value = isnegative ? -static_cast<int64_t>( absolute ) : static_cast<int64_t>( absolute );
+    return true;
+}
+
+// Parses a floating point number with optional spaces around it, as float() without underscores,
+// returning false when it is not one. The copy into `buffer` ends the number with a zero character,
+// as PyOS_string_to_double() requires.
+static inline bool fastfile_parsedouble(const char* start, size_t size, std::string& buffer, double& value) {
+    const char* end = start + size;
+
+    while( start < end && start[0] == ' ' ) {
+        ++start;
+    }
+
+    while( start < end && end[-1] == ' ' ) {
+        --end;
+    }
+
+    char* numberend;
+    buffer.assign( start, end );
+    value = PyOS_string_to_double( buffer.c_str(), &numberend, NULL );
+
+    if( value == -1.0 && PyErr_Occurred() ) {
+        PyErr_Clear();
+        return false;
+    }
+    return start != end && numberend == buffer.c_str() + buffer.size();
+}
+
+/**
+ * Splits a line into its fields with the same 64 bytes masks of FastFileScanner, then, a line with
+ * short fields is split without comparing each one of its characters.
+ *
+ * With `quote`, the delimiters between two quotes are not split, as on CSV files, where the quotes
+ * are toggled by the prefix xor of the quote characters mask, carrying the last state to the next
+ * block. A field starting and ending with a quote has them removed, and a doubled quote inside it
+ * is only unescaped by unescape() when the field becomes a Python object. As the lines were already
+ * split, a quoted field cannot have a new line character.
+ */
+struct FastFileFieldSplitter {
+    fastfile_blockmask_function charmask;
+    char delimiter;
+    char quote;
+    bool hasquote;
+    std::string unescaped;
+
+    FastFileFieldSplitter() :
+            charmask(fastfile_charmask64_select()),
+            delimiter(','),
+            quote('"'),
+            hasquote(false)
+    {
+    }
+
+    void setup(const FastFileFieldOptions& fieldoptions) {
+        delimiter = fieldoptions.delimiter;
+        quote = fieldoptions.quote;
+        hasquote = fieldoptions.hasquote;
+    }
+
+    // Splits only up to `maxfields` fields, as the others would not be used
+    void split(const char* line, size_t size, std::vector<FastFileField>& fields, size_t maxfields) {
+        const char* fieldstart = line;
+        uint64_t isinsidequotes = 0;
+        fields.clear();
+
+        for( size_t blockoffset = 0; blockoffset < size; blockoffset += 64 ) {
+            const char* block = line + blockoffset;
+            size_t blocksize = std::min( size - blockoffset, static_cast<size_t>( 64 ) );
+            uint64_t mask = _delimitermask( block, blocksize, isinsidequotes );
+
+            while( mask ) {
+                const char* found = block + fastfile_trailingzeros64( mask );
+                mask &= mask - 1;
+
+                _pushfield( fields, fieldstart, found );
+                fieldstart = found + 1;
+
+                if( fields.size() == maxfields ) {
+                    return;
+                }
+            }
+        }
+        _pushfield( fields, fieldstart, line + size );
+    }
+
+    // Returns the field characters with its doubled quotes replaced by a single quote
+    const char* unescape(const FastFileField& field, size_t& size) {
+        unescaped.clear();
+
+        for( size_t index = 0; index < field.size; ++index ) {
+            unescaped.push_back( field.start[index] );
+            index += field.start[index] == quote && index + 1 < field.size && field.start[index + 1] == quote;
+        }
+
+        size = unescaped.size();
+        return unescaped.data();
+    }
+
+    void _pushfield(std::vector<FastFileField>& fields, const char* start, const char* end) {
+        FastFileField field = { start, static_cast<size_t>( end - start ), false };
+
+        if( hasquote && field.size >= 2 && start[0] == quote && end[-1] == quote ) {
+            field.start += 1;
+            field.size -= 2;
+            field.isescaped = memchr( field.start, quote, field.size ) != NULL;
+        }
+        fields.push_back( field );
+    }
+
+    // The delimiters of the block outside quotes, `isinsidequotes` is all bits set when the block
+    // starts inside quotes, and it becomes the state at the block end
+    uint64_t _delimitermask(const char* block, size_t blocksize, uint64_t& isinsidequotes) {
+        char lastblock[64];
+        uint64_t validmask = ~static_cast<uint64_t>( 0 );
+
+        // the last block is copied, instead of reading after the line end
+        if( blocksize < 64 ) {
+            memset( lastblock, 0, sizeof( lastblock ) );
+            memcpy( lastblock, block, blocksize );
+            block = lastblock;
+            validmask = ( static_cast<uint64_t>( 1 ) << blocksize ) - 1;
+        }
+
+        uint64_t mask = charmask( block, delimiter ) & validmask;
+
+        if( hasquote ) {
+            uint64_t insidemask = fastfile_prefixxor64( charmask( block, quote ) & validmask ) ^ isinsidequotes;
+            isinsidequotes = static_cast<uint64_t>( 0 ) - ( insidemask >> 63 );
+            mask &= ~insidemask;
+        }
+        return mask;
+    }
+};
+
+#endif // FASTFILE_APP_FIELDS_H
@@ -0,0 +1,189 @@
+#ifndef FASTFILE_APP_FOLLOW_H
+#define FASTFILE_APP_FOLLOW_H
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+    // https://man7.org/linux/man-pages/man7/inotify.7.html
+    #include <poll.h>
+    #include <sys/inotify.h>
+#endif
+
+// How long the follower sleeps before taking the GIL back, to check for signals and close()
+#define FASTFILE_FOLLOW_WAKEUP 200
+
+#define FASTFILE_FOLLOW_WAITING   0
+#define FASTFILE_FOLLOW_GREW      1
+#define FASTFILE_FOLLOW_TRUNCATED 2
+#define FASTFILE_FOLLOW_REPLACED  3
+#define FASTFILE_FOLLOW_ROTATED   4
+
+/**
+ * Waits for a file being followed to change, without polling it. The file is watched with inotify
+ * for writes, and its directory for a new file created with the same name, as when a log rotates.
+ * All the events queued while the lines were being read are consumed by a single read(), then, a
+ * writer appending many lines only wakes up the follower once for all of them.
+ *
+ * The file is also kept open, then, after it is renamed or removed, the lines written to it since
+ * the reader stopped are still read from `descriptorpath`, before going to the new file, as tail -F.
+ *
+ * Without inotify, the file is only checked again every FASTFILE_FOLLOW_WAKEUP milliseconds.
+ */
+struct FastFileFollower {
+    std::string filepath;
+    uint64_t inode;
+    bool hasinode;
+
+    // the followed file, and the path the backends open it again with, even after a rotation
+    int filedescriptor;
+    std::string descriptorpath;
+
+    int inotifydescriptor;
+    int filewatch;
+
+    FastFileFollower() :
+            inode(0),
+            hasinode(false),
+            filedescriptor(-1),
+            inotifydescriptor(-1),
+            filewatch(-1)
+    {
+    }
+
+    ~FastFileFollower() {
+        stop();
+    }
+
+    void start(const std::string& newfilepath) {
+        filepath = newfilepath;
+        _openfile();
+
+    #if defined(__linux__)
+        inotifydescriptor = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+
+        if( inotifydescriptor == -1 ) {
+            std::cerr << "ERROR: FastFile failed to create an inotify instance to follow the file '"
+                    << filepath << "', it is checked every " << FASTFILE_FOLLOW_WAKEUP << " milliseconds!" << std::endl;
+            return;
+        }
+
+        std::string directory = filepath.substr( 0, filepath.find_last_of( '/' ) + 1 );
+        inotify_add_watch( inotifydescriptor, directory.empty() ? "." : directory.c_str(), IN_CREATE | IN_MOVED_TO );
+        _watchfile();
+    #endif
+    }
+
+    void stop() {
+        if( filedescriptor != -1 ) {
+            ::close( filedescriptor );
+            filedescriptor = -1;
+        }
+
+    #if defined(__linux__)
+        if( inotifydescriptor != -1 ) {
+            ::close( inotifydescriptor );
+            inotifydescriptor = -1;
+            filewatch = -1;
+        }
+    #endif
+    }
+
+    // Returns how the file changed since the reader stopped at `offset`, or FASTFILE_FOLLOW_WAITING
+    // after waiting up to `timeout` milliseconds for it to change. FASTFILE_FOLLOW_ROTATED is returned
+    // while the file was replaced, but it still has lines after `offset`. It does not touch Python objects.
+    int wait(uint64_t offset, int timeout) {
+        struct stat filestatus;
+
+        // while a log is rotated, there can be no file with its name for a while
+        bool hasfile = stat( filepath.c_str(), &filestatus ) == 0;
+
+        if( hasinode && ( !hasfile || static_cast<uint64_t>( filestatus.st_ino ) != inode ) ) {
+            struct stat rotatedstatus;
+
+            if( filedescriptor != -1 && fstat( filedescriptor, &rotatedstatus ) == 0
+                    && static_cast<uint64_t>( rotatedstatus.st_size ) > offset )
+            {
+                return FASTFILE_FOLLOW_ROTATED;
+            }
+        }
+
+        if( hasfile ) {
+            if( hasinode && static_cast<uint64_t>( filestatus.st_ino ) != inode ) {
+                _openfile();
+                _watchfile();
+                return FASTFILE_FOLLOW_REPLACED;
+            }
+
+            if( static_cast<uint64_t>( filestatus.st_size ) < offset ) {
+                return FASTFILE_FOLLOW_TRUNCATED;
+            }
+
+            if( static_cast<uint64_t>( filestatus.st_size ) > offset ) {
+                return FASTFILE_FOLLOW_GREW;
+            }
+        }
+
+    #if defined(__linux__)
+        if( inotifydescriptor != -1 ) {
+            struct pollfd pollinotify = { inotifydescriptor, POLLIN, 0 };
+
+            if( poll( &pollinotify, 1, timeout ) > 0 ) {
+                char events[4096];
+                while( read( inotifydescriptor, events, sizeof(events) ) > 0 ) {
+                }
+            }
+            return FASTFILE_FOLLOW_WAITING;
+        }
+    #endif
+
+        std::this_thread::sleep_for( std::chrono::milliseconds( timeout ) );
+        return FASTFILE_FOLLOW_WAITING;
+    }
+
+    // Opens the file with `filepath` name now, instead of the one open
+    void _openfile() {
+        if( filedescriptor != -1 ) {
+            ::close( filedescriptor );
+        }
+
+        struct stat filestatus;
+        filedescriptor = ::open( filepath.c_str(), O_RDONLY | O_CLOEXEC );
+
+        if( filedescriptor != -1 && fstat( filedescriptor, &filestatus ) == 0 ) {
+            descriptorpath = "/dev/fd/" + std::to_string( filedescriptor );
+        }
+        else if( stat( filepath.c_str(), &filestatus ) != 0 ) {
+            hasinode = false;
+            return;
+        }
+
+        inode = filestatus.st_ino;
+        hasinode = true;
+    }
+
+    void _watchfile() {
+    #if defined(__linux__)
+        if( inotifydescriptor == -1 ) {
+            return;
+        }
+
+        // a new file with the same name needs its own watch
+        if( filewatch != -1 ) {
+            inotify_rm_watch( inotifydescriptor, filewatch );
+        }
+
+        filewatch = inotify_add_watch( inotifydescriptor, filepath.c_str(),
+                IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF );
+    #endif
+    }
+};
+
+#endif // FASTFILE_APP_FOLLOW_H
@@ -0,0 +1,524 @@
+#ifndef FASTFILE_APP_LINE_CACHE_H
+#define FASTFILE_APP_LINE_CACHE_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "fastfileutf8.h"
+#include "fastfilearena.h"
+#include "fastfilefields.h"
+#include "fastfilecolumns.h"
+#include "fastfilededup.h"
+
+#define FASTFILE_LINECACHE_MINIMUMSPANS 16
+
+// The Python objects returned for each line, picked with the `mode` constructor keyword
+#define FASTFILE_MODE_TEXT  0
+#define FASTFILE_MODE_BYTES 1
+#define FASTFILE_MODE_VIEW  2
+
+// The `mode`, `dedup`, `lineindex`, `indexfile` and `follow` constructor keywords, `dedup` is how
+// many distinct lines are remembered, see FastFileLineIndex and FastFileFollower for the others
+struct FastFileLineOptions {
+    int mode;
+    size_t dedup;
+    bool lineindex;
+    std::string indexfile;
+    bool follow;
+
+    // The control character kept by the FASTFILE_TRIMUFT8 trimming, as the constructor fields
+    // `delimiter` when it is the tab character, see fastfile_trimlinekeeping()
+    int keptcharacter;
+
+    FastFileLineOptions() :
+            mode(FASTFILE_MODE_TEXT),
+            dedup(0),
+            lineindex(false),
+            follow(false),
+            keptcharacter(FASTFILE_TRIMUFT8_KEEPNONE)
+    {
+    }
+};
+
+// A cached line, `pythonobject` is only created when the line is returned to Python
+struct FastFileLineSpan {
+    const char* line;
+    size_t size;
+    unsigned int block;
+    PyObject* pythonobject;
+};
+
+// The object behind each memoryview returned with FASTFILE_MODE_VIEW, it pins its line arena block
+struct FastFileLineView {
+    PyObject_HEAD
+    FastFileArenaBuffer* buffer;
+    const char* line;
+    Py_ssize_t size;
+};
+
+static int fastfile_viewgetbuffer(PyObject* exporter, Py_buffer* view, int flags) {
+    FastFileLineView* lineview = reinterpret_cast<FastFileLineView*>( exporter );
+    return PyBuffer_FillInfo( view, exporter, const_cast<char*>( lineview->line ), lineview->size, 1, flags );
+}
+
+static void fastfile_viewdealloc(PyObject* exporter) {
+    FastFileArena::unpin( reinterpret_cast<FastFileLineView*>( exporter )->buffer );
+    Py_TYPE( exporter )->tp_free( exporter );
+}
+
+// It is not static, then, all the files including this header share the same type object, which
+// PyInit_fastfilepackage() readies
+inline PyTypeObject* fastfile_viewtype() {
+    static PyBufferProcs viewbuffer = { fastfile_viewgetbuffer, NULL };
+    static PyTypeObject viewtype = { PyVarObject_HEAD_INIT( NULL, 0 ) "fastfilepackage.FastFileLineView" };
+
+    if( viewtype.tp_basicsize == 0 ) {
+        viewtype.tp_basicsize = sizeof(FastFileLineView);
+        viewtype.tp_dealloc = fastfile_viewdealloc;
+        viewtype.tp_as_buffer = &viewbuffer;
+        viewtype.tp_flags = Py_TPFLAGS_DEFAULT;
+        viewtype.tp_doc = "The line shared by each FastFile memoryview";
+    }
+    return &viewtype;
+}
+
+// Returns a new reference to an object without any characters for `mode`
+static inline PyObject* fastfile_emptyobject(int mode) {
+    switch( mode ) {
+        case FASTFILE_MODE_BYTES:
+            return PyBytes_FromStringAndSize( "", 0 );
+        case FASTFILE_MODE_VIEW:
+            return PyMemoryView_FromMemory( const_cast<char*>( "" ), 0, PyBUF_READ );
+        default:
+            return PyUnicode_DecodeUTF8( "", 0, "ignore" );
+    }
+}
+
+// Returns a new reference to a compact ASCII string, the `line` must only have characters below 128,
+// then, it is copied as it is, without the UTF-8 validation and the error handler of PyUnicode_DecodeUTF8()
+static inline PyObject* fastfile_asciiobject(const char* line, size_t size) {
+    PyObject* pythonobject = PyUnicode_New( size, 127 );
+
+    if( pythonobject != NULL ) {
+        memcpy( PyUnicode_1BYTE_DATA( pythonobject ), line, size );
+    }
+    return pythonobject;
+}
+
+/**
+ * The lines read ahead of the current line, oldest first. The lines are kept as spans into the
+ * byte arena, on a ring whose capacity is a power of two, then, reading a line only copies its
+ * bytes, and a line dropped by the regex filter on FastFile::call() never becomes a Python object.
+ *
+ * The lines become `str` objects, or `bytes` without decoding them, or memoryviews pinning the arena
+ * block of their line, i.e., they are never copied again, and they stay valid after the cache
+ * moved on, as the arena gives up a pinned block instead of writing over it.
+ *
+ * With `isascii`, all the lines were trimmed to printable ASCII characters by FASTFILE_TRIMUFT8=1,
+ * and the `str` objects are created by copying them as they are, instead of decoding them. With
+ * `isutf8`, the lines only have valid UTF-8 characters, as any FASTFILE_TRIMUFT8 mode leaves them.
+ *
+ * With the `dedup` cache, a `str` or `bytes` line equal to one of the last lines returned is
+ * returned as the same object, without decoding it again. The memoryviews are never shared.
+ *
+ * With `isfields`, each line becomes a tuple with its fields as `str` or `bytes`, or only with the
+ * fields on `columns`, then, the other fields never become Python objects. With `types`, these
+ * fields are parsed straight into `int` or `float` objects, without creating their strings, and
+ * an empty number field is None. appendcolumns() puts the same fields on the column buffers of
+ * FastFile::readcolumns() instead, without creating any object.
+ */
+struct FastFileLineCache {
+    std::vector<FastFileLineSpan> spans;
+    size_t mask;
+    size_t head;
+    size_t count;
+
+    int mode;
+    bool isascii;
+    bool isutf8;
+    FastFileArena arena;
+    FastFileDedup dedup;
+
+    bool isfields;
+    size_t maxfields;
+    FastFileFieldOptions fieldoptions;
+    FastFileFieldSplitter splitter;
+    std::vector<FastFileField> fields;
+    std::string numberbuffer;
+
+    FastFileLineCache() :
+            mask(0),
+            head(0),
+            count(0),
+            mode(FASTFILE_MODE_TEXT),
+            isascii(false),
+            isutf8(false),
+            isfields(false),
+            maxfields(0)
+    {
+    }
+
+    ~FastFileLineCache() {
+        clear();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    FastFileLineSpan& span(size_t index) {
+        return spans[( head + index ) & mask];
+    }
+
+    const char* line(size_t index) {
+        return span( index ).line;
+    }
+
+    size_t linesize(size_t index) {
+        return span( index ).size;
+    }
+
+    void setoptions(const FastFileLineOptions& lineoptions) {
+        mode = lineoptions.mode;
+
+        if( mode != FASTFILE_MODE_VIEW ) {
+            dedup.reserve( lineoptions.dedup );
+        }
+    }
+
+    // The lines not returned yet become field tuples, the lines remembered by `dedup` are forgotten,
+    // as they are not tuples, or they are tuples with other columns
+    void setfields(const FastFileFieldOptions& newfieldoptions) {
+        isfields = true;
+        fieldoptions = newfieldoptions;
+        splitter.setup( fieldoptions );
+        dedup.clear();
+
+        // the fields after the last column are not split
+        std::vector<size_t>& columns = fieldoptions.columns;
+        maxfields = columns.empty() ? SIZE_MAX : *std::max_element( columns.begin(), columns.end() ) + 1;
+    }
+
+    // Returns a borrowed reference to the line Python object, creating it on the first call
+    PyObject* object(size_t index) {
+        FastFileLineSpan& linespan = span( index );
+
+        if( linespan.pythonobject == NULL ) {
+            linespan.pythonobject = dedup.isenabled() ? _dedupobject( linespan ) : _newobject( linespan );
+        }
+        return linespan.pythonobject;
+    }
+
+    // Returns a new reference
+    PyObject* _newobject(const FastFileLineSpan& linespan) {
+        if( isfields ) {
+            return _newfields( linespan );
+        }
+
+        switch( mode ) {
+            case FASTFILE_MODE_BYTES:
+                return PyBytes_FromStringAndSize( linespan.line, linespan.size );
+            case FASTFILE_MODE_VIEW:
+                return _newview( linespan );
+            default:
+                return _newtext( linespan.line, linespan.size );
+        }
+    }
+
+    PyObject* _newtext(const char* line, size_t size) {
+        return isascii ? fastfile_asciiobject( line, size ) : PyUnicode_DecodeUTF8( line, size, "ignore" );
+    }
+
+    // Returns a new reference to a tuple with the line fields, or with its `columns` fields, where
+    // the columns after the line last field are None
+    PyObject* _newfields(const FastFileLineSpan& linespan) {
+        std::vector<size_t>& columns = fieldoptions.columns;
+        splitter.split( linespan.line, linespan.size, fields, maxfields );
+
+        size_t tuplesize = columns.empty() ? fields.size() : columns.size();
+        PyObject* tuple = PyTuple_New( tuplesize );
+
+        for( size_t index = 0; tuple != NULL && index < tuplesize; ++index ) {
+            size_t column = columns.empty() ? index : columns[index];
+            PyObject* pythonobject = Py_None;
+
+            if( column < fields.size() && !( fields[column].size == 0 && _isnumber( index ) ) ) {
+                pythonobject = _newfield( fields[column], index );
+
+                if( pythonobject == NULL ) {
+                    Py_DECREF( tuple );
+                    return NULL;
+                }
+            }
+            else {
+                Py_INCREF( pythonobject );
+            }
+            PyTuple_SET_ITEM( tuple, index, pythonobject );
+        }
+        return tuple;
+    }
+
+    // The type of the `index` column, without `types`, the lines `mode` picks `str` or `bytes`
+    int fieldtype(size_t index) {
+        return fieldoptions.types.empty() ? ( mode == FASTFILE_MODE_BYTES ? FASTFILE_TYPE_BYTES : FASTFILE_TYPE_STR )
+                : fieldoptions.types[index];
+    }
+
+    bool _isnumber(size_t index) {
+        return fieldtype( index ) >= FASTFILE_TYPE_INT;
+    }
+
+    // The numbers with underscores, or raising ValueError as float() does
+    PyObject* _newfloat(const char* start, size_t size) {
+        PyObject* text = _newtext( start, size );
+
+        if( text == NULL ) {
+            return NULL;
+        }
+
+        PyObject* number = PyFloat_FromString( text );
+        Py_DECREF( text );
+        return number;
+    }
+
+    // Returns a new reference to the field object for the `index` column type, or NULL with
+    // ValueError when the field is not a number, as int() and float() would raise
+    PyObject* _newfield(const FastFileField& field, size_t index) {
+        size_t size = field.size;
+        const char* start = field.isescaped ? splitter.unescape( field, size ) : field.start;
+        switch( fieldtype( index ) ) {
+            case FASTFILE_TYPE_BYTES:
+                return PyBytes_FromStringAndSize( start, size );
+            case FASTFILE_TYPE_INT: {
+                int64_t integer;
+
+                if( fastfile_parseinteger( start, size, integer ) ) {
+                    return PyLong_FromLongLong( integer );
+                }
+
+                // the numbers with more digits, or with underscores as int() accepts
+                numberbuffer.assign( start, size );
+                return PyLong_FromString( numberbuffer.c_str(), NULL, 10 );
+            }
+            case FASTFILE_TYPE_FLOAT: {
+                double number;
+
+                if( fastfile_parsedouble( start, size, numberbuffer, number ) ) {
+                    return PyFloat_FromDouble( number );
+                }
+                return _newfloat( start, size );
+            }
+            default:
+                return _newtext( start, size );
+        }
+    }
+
+    // Returns a new reference to the object remembered for an equal line, or to a new one
+    PyObject* _dedupobject(const FastFileLineSpan& linespan) {
+        uint64_t hash = fastfile_hashline( linespan.line, linespan.size );
+        PyObject* pythonobject = dedup.find( linespan.line, linespan.size, hash );
+
+        if( pythonobject != NULL ) {
+            Py_INCREF( pythonobject );
+            return pythonobject;
+        }
+
+        pythonobject = _newobject( linespan );
+        if( pythonobject != NULL ) {
+            dedup.insert( linespan.line, linespan.size, hash, pythonobject );
+        }
+        return pythonobject;
+    }
+
+    // Appends the `columns` fields of the line `index` to the column buffers, without creating any
+    // Python object, but for the numbers only parsed by int() and float(), returning false with
+    // ValueError when a field is not a number
+    bool appendcolumns(size_t index, std::vector<FastFileColumnData*>& columndatas) {
+        const FastFileLineSpan& linespan = span( index );
+        std::vector<size_t>& columns = fieldoptions.columns;
+        splitter.split( linespan.line, linespan.size, fields, maxfields );
+
+        for( size_t columnindex = 0; columnindex < columns.size(); ++columnindex ) {
+            FastFileColumnData* columndata = columndatas[columnindex];
+            size_t column = columns[columnindex];
+
+            if( column >= fields.size() || ( fields[column].size == 0 && columndata->isnumber() ) ) {
+                columndata->appendnull();
+                continue;
+            }
+
+            size_t size = fields[column].size;
+            const char* start = fields[column].isescaped ? splitter.unescape( fields[column], size ) : fields[column].start;
+
+            if( !_appendfield( columndata, start, size ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool _appendfield(FastFileColumnData* columndata, const char* start, size_t size) {
+        switch( columndata->type ) {
+            case FASTFILE_TYPE_INT: {
+                int64_t integer;
+
+                if( !fastfile_parseinteger( start, size, integer ) ) {
+                    numberbuffer.assign( start, size );
+                    PyObject* number = PyLong_FromString( numberbuffer.c_str(), NULL, 10 );
+
+                    if( number == NULL ) {
+                        return false;
+                    }
+
+                    integer = PyLong_AsLongLong( number );
+                    Py_DECREF( number );
+
+                    if( integer == -1 && PyErr_Occurred() ) {
+                        return false;
+                    }
+                }
+                columndata->appendinteger( integer );
+                return true;
+            }
+            case FASTFILE_TYPE_FLOAT: {
+                double number;
+
+                if( !fastfile_parsedouble( start, size, numberbuffer, number ) ) {
+                    PyObject* pythonobject = _newfloat( start, size );
+
+                    if( pythonobject == NULL ) {
+                        return false;
+                    }
+
+                    number = PyFloat_AS_DOUBLE( pythonobject );
+                    Py_DECREF( pythonobject );
+                }
+                columndata->appenddouble( number );
+                return true;
+            }
+            case FASTFILE_TYPE_STR:
+                // without FASTFILE_TRIMUFT8, the invalid UTF-8 sequences are dropped as _newtext() does
+                if( !isutf8 && fastfile_utf8prefix( start, size ) != size ) {
+                    PyObject* text = PyUnicode_DecodeUTF8( start, size, "ignore" );
+                    Py_ssize_t textsize;
+                    const char* utf8 = text ? PyUnicode_AsUTF8AndSize( text, &textsize ) : NULL;
+
+                    if( utf8 == NULL ) {
+                        Py_XDECREF( text );
+                        return false;
+                    }
+
+                    columndata->appendcharacters( utf8, textsize );
+                    Py_DECREF( text );
+                    return true;
+                }
+                columndata->appendcharacters( start, size );
+                return true;
+            default:
+                columndata->appendcharacters( start, size );
+                return true;
+        }
+    }
+
+    PyObject* _newview(const FastFileLineSpan& linespan) {
+        FastFileLineView* lineview = PyObject_New( FastFileLineView, fastfile_viewtype() );
+
+        if( lineview == NULL ) {
+            return NULL;
+        }
+
+        lineview->buffer = arena.pin( linespan.block );
+        lineview->line = linespan.line;
+        lineview->size = linespan.size;
+
+        // the memoryview keeps the only reference to its line view
+        PyObject* memoryview = PyMemoryView_FromObject( reinterpret_cast<PyObject*>( lineview ) );
+        Py_DECREF( lineview );
+        return memoryview;
+    }
+
+    // Copies a new line into the cache end, it does not touch any Python object
+    bool push(const char* line, size_t size) {
+        if( count == spans.size() && !_growspans() ) {
+            return false;
+        }
+
+        FastFileLineSpan& linespan = spans[( head + count ) & mask];
+        char* destination = arena.allocate( size, linespan.block );
+
+        if( destination == NULL ) {
+            return false;
+        }
+
+        memcpy( destination, line, size );
+        linespan.line = destination;
+        linespan.size = size;
+        linespan.pythonobject = NULL;
+        ++count;
+        return true;
+    }
+
+    // Trims a new line with the FASTFILE_TRIMUFT8 `trimming` mode while copying it into the cache end,
+    // keeping the `kept` control character
+    bool pushtrimmed(const char* line, size_t size, int trimming, int kept) {
+        if( count == spans.size() && !_growspans() ) {
+            return false;
+        }
+
+        FastFileLineSpan& linespan = spans[( head + count ) & mask];
+        char* destination = arena.allocate( size, linespan.block );
+
+        if( destination == NULL ) {
+            return false;
+        }
+
+        linespan.line = destination;
+        linespan.size = fastfile_trimlinekeeping( trimming, kept, destination, line, size );
+        linespan.pythonobject = NULL;
+        arena.shrink( size, linespan.size );
+        ++count;
+        return true;
+    }
+
+    void pop_front() {
+        FastFileLineSpan& linespan = spans[head];
+        Py_XDECREF( linespan.pythonobject );
+        arena.release( linespan.block, linespan.size );
+
+        head = ( head + 1 ) & mask;
+        --count;
+    }
+
+    void clear() {
+        while( count ) {
+            pop_front();
+        }
+        dedup.clear();
+        arena.clear();
+    }
+
+    // Doubles the ring, putting the oldest line back on its first slot
+    bool _growspans() {
+        size_t newcapacity = spans.empty() ? FASTFILE_LINECACHE_MINIMUMSPANS : spans.size() * 2;
+        std::vector<FastFileLineSpan> newspans( newcapacity );
+
+        for( size_t index = 0; index < count; ++index ) {
+            newspans[index] = span( index );
+        }
+
+        spans.swap( newspans );
+        mask = newcapacity - 1;
+        head = 0;
+        return true;
+    }
+};
+
+#endif // FASTFILE_APP_LINE_CACHE_H
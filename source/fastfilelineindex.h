@@ -0,0 +1,524 @@
+#ifndef FASTFILE_APP_LINE_INDEX_H
+#define FASTFILE_APP_LINE_INDEX_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#if defined(__unix__)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "fastfilesimd.h"
+#include "fastfileworkers.h"
+
+// One index entry every this many lines, seekline() reads at most this many lines to get anywhere
+#define FASTFILE_LINEINDEX_STEP      1024
+#define FASTFILE_LINEINDEX_CHUNKSIZE 1048576
+#define FASTFILE_LINEINDEX_MAGIC     "FFLINDX2"
+
+// The new lines are counted for each block, and each index thread gets at least a range this big
+#define FASTFILE_LINEINDEX_BLOCKSIZE     4096
+#define FASTFILE_LINEINDEX_MINIMUMRANGE  8388608
+
+// The sidecar file starts with this header, followed by `entries` offsets
+struct FastFileLineIndexHeader {
+    char magic[8];
+    uint64_t inode;
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t mtimensec;
+    uint64_t ctime;
+    uint64_t ctimensec;
+    uint64_t step;
+    uint64_t lines;
+    uint64_t entries;
+};
+
+// The nanoseconds of the modification and the status change times, as a file rewritten twice on the
+// same second keeps its `st_mtime`, where the platforms without them only have the seconds
+static inline void fastfile_filetimes(const struct stat& filestatus, uint64_t& mtimensec, uint64_t& ctimensec) {
+#if defined(__APPLE__)
+    mtimensec = filestatus.st_mtimespec.tv_nsec;
+    ctimensec = filestatus.st_ctimespec.tv_nsec;
+#elif defined(__unix__)
+    mtimensec = filestatus.st_mtim.tv_nsec;
+    ctimensec = filestatus.st_ctim.tv_nsec;
+#else
+    mtimensec = 0;
+    ctimensec = 0;
+#endif
+}
+
+// The `rank`-th new line of the block `block` is right before an indexed line
+struct FastFileLineIndexTarget {
+    uint64_t block;
+    unsigned int rank;
+};
+
+/**
+ * A sparse index with the offset of one line every FASTFILE_LINEINDEX_STEP lines. It is built by
+ * reading the whole file once, on a native thread started by start(), or when it is first needed,
+ * with up to `threads` threads, each one reading its own part of the file with pread(), or from a
+ * mapping of the file with `usemapping`.
+ *
+ * When there is an `indexfile`, the index is loaded from it, if it was saved for a file with the
+ * same inode, size, modification and status change times, otherwise, the index is saved on it after being built.
+ */
+struct FastFileLineIndex {
+    std::string filepath;
+    std::string indexfile;
+
+    std::vector<uint64_t> offsets;
+    uint64_t lines;
+    uint64_t filesize;
+
+    unsigned int threads;
+    bool usemapping;
+
+    std::thread builder;
+    std::atomic<bool> isstopping;
+    bool hasstarted;
+    bool hasbuilt;
+    bool isbuilt;
+
+    FastFileLineIndex() :
+            lines(0),
+            filesize(0),
+            threads(std::max( std::thread::hardware_concurrency(), 1u )),
+            usemapping(false),
+            isstopping(false),
+            hasstarted(false),
+            hasbuilt(false),
+            isbuilt(false)
+    {
+    }
+
+    ~FastFileLineIndex() {
+        stop();
+    }
+
+    void setup(const std::string& newfilepath, const std::string& newindexfile) {
+        filepath = newfilepath;
+        indexfile = newindexfile;
+    }
+
+    // Builds the index on a native thread, while the file is still being read
+    void start() {
+        if( hasstarted || hasbuilt ) {
+            return;
+        }
+
+        hasstarted = true;
+        builder = std::thread( &FastFileLineIndex::_build, this );
+    }
+
+    // Returns whether the index is ready, building it right now if start() was not called. It does
+    // not touch any Python object.
+    bool wait() {
+        if( hasstarted ) {
+            builder.join();
+            hasstarted = false;
+        }
+        else if( !hasbuilt ) {
+            _build();
+        }
+        return isbuilt;
+    }
+
+    void stop() {
+        if( hasstarted ) {
+            isstopping.store( true );
+            builder.join();
+            hasstarted = false;
+        }
+    }
+
+    // Returns where the line is found, i.e., the offset of the closest indexed line before it, and
+    // how many lines to skip after it. A line after the file end gives the file size.
+    void find(uint64_t line, uint64_t& offset, uint64_t& skiplines) {
+        if( line >= lines ) {
+            offset = filesize;
+            skiplines = 0;
+            return;
+        }
+
+        offset = offsets[line / FASTFILE_LINEINDEX_STEP];
+        skiplines = line % FASTFILE_LINEINDEX_STEP;
+    }
+
+    void _build() {
+        struct stat filestatus;
+        isbuilt = false;
+
+        if( stat( filepath.c_str(), &filestatus ) == 0 ) {
+            if( indexfile.size() && _load( filestatus ) ) {
+                isbuilt = true;
+            }
+            else if( _scan() ) {
+                isbuilt = true;
+
+                if( indexfile.size() ) {
+                    _save( filestatus );
+                }
+            }
+        }
+        else {
+            std::cerr << "ERROR: FastFile failed to get the status of the file '" << filepath << "'!" << std::endl;
+        }
+
+        hasbuilt = true;
+    }
+
+#if defined(__unix__)
+    bool _scan() {
+        int filedescriptor = ::open( filepath.c_str(), O_RDONLY );
+
+        if( filedescriptor == -1 ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "' to index its lines!" << std::endl;
+            return false;
+        }
+
+        struct stat filestatus;
+        if( fstat( filedescriptor, &filestatus ) == -1 ) {
+            std::cerr << "ERROR: FastFile failed to get the size of the file '" << filepath << "'!" << std::endl;
+            ::close( filedescriptor );
+            return false;
+        }
+
+        filesize = filestatus.st_size;
+        const char* filemapping = NULL;
+
+        // without the mapping, the file ranges are read with pread()
+        if( usemapping && filesize ) {
+            void* mappingresult = mmap( NULL, filesize, PROT_READ, MAP_PRIVATE, filedescriptor, 0 );
+
+            if( mappingresult == MAP_FAILED ) {
+                std::cerr << "ERROR: FastFile failed to map the file '" << filepath << "' into memory!" << std::endl;
+            }
+            else {
+                madvise( mappingresult, filesize, MADV_SEQUENTIAL );
+                filemapping = static_cast<const char*>( mappingresult );
+            }
+        }
+
+        bool hasscanned = _scanparallel( filedescriptor, filemapping );
+
+        if( filemapping != NULL ) {
+            munmap( const_cast<char*>( filemapping ), filesize );
+        }
+        ::close( filedescriptor );
+        return hasscanned;
+    }
+
+    /**
+     * The file is split into one byte range for each worker, and each worker counts the new lines
+     * of each 4KB block of its range. The prefix sum of these counts gives the block and the rank of
+     * the new line before each indexed line, then, the workers only read again the blocks with an
+     * indexed line, to find where it starts.
+     */
+    bool _scanparallel(int filedescriptor, const char* filemapping) {
+        uint64_t blockcount = ( filesize + FASTFILE_LINEINDEX_BLOCKSIZE - 1 ) / FASTFILE_LINEINDEX_BLOCKSIZE;
+        std::vector<uint16_t> blockcounts( blockcount );
+
+        uint64_t rangecount = filesize / FASTFILE_LINEINDEX_MINIMUMRANGE;
+        unsigned int workercount = static_cast<unsigned int>( std::max( static_cast<uint64_t>( 1 ),
+                std::min( static_cast<uint64_t>( threads ), rangecount ) ) );
+
+        FastFileWorkers workers;
+        workers.start( workercount );
+        std::atomic<bool> haserror( false );
+
+        workers.run( [&]( unsigned int worker ) {
+            if( !_countblocks( filedescriptor, filemapping, blockcounts,
+                    blockcount * worker / workercount, blockcount * ( worker + 1 ) / workercount ) )
+            {
+                haserror.store( true );
+            }
+        } );
+
+        if( haserror.load() || isstopping.load() ) {
+            return false;
+        }
+
+        char lastcharacter = '\n';
+        if( filesize && !_readrange( filedescriptor, filemapping, &lastcharacter, 1, filesize - 1 ) ) {
+            return false;
+        }
+
+        // the new line number `line` starts the line `line`, except the last new line of the file
+        std::vector<FastFileLineIndexTarget> targets;
+        uint64_t newlines = 0;
+        uint64_t nextline = FASTFILE_LINEINDEX_STEP;
+
+        for( uint64_t block = 0; block < blockcount; ++block ) {
+            uint64_t blocknewlines = newlines + blockcounts[block];
+
+            for( ; nextline <= blocknewlines; nextline += FASTFILE_LINEINDEX_STEP ) {
+                FastFileLineIndexTarget target = { block, static_cast<unsigned int>( nextline - newlines ) };
+                targets.push_back( target );
+            }
+            newlines = blocknewlines;
+        }
+
+        lines = newlines + ( lastcharacter != '\n' );
+        offsets.assign( ( lines + FASTFILE_LINEINDEX_STEP - 1 ) / FASTFILE_LINEINDEX_STEP, 0 );
+        targets.resize( offsets.size() ? offsets.size() - 1 : 0 );
+
+        workers.run( [&]( unsigned int worker ) {
+            size_t firsttarget = targets.size() * worker / workercount;
+            size_t lasttarget = targets.size() * ( worker + 1 ) / workercount;
+
+            if( !_findlines( filedescriptor, filemapping, targets, firsttarget, lasttarget ) ) {
+                haserror.store( true );
+            }
+        } );
+
+        return !haserror.load();
+    }
+
+    bool _countblocks(int filedescriptor, const char* filemapping, std::vector<uint16_t>& blockcounts,
+            uint64_t firstblock, uint64_t lastblock)
+    {
+        const uint64_t chunkblocks = FASTFILE_LINEINDEX_CHUNKSIZE / FASTFILE_LINEINDEX_BLOCKSIZE;
+        std::vector<char> chunk( filemapping ? 0 : FASTFILE_LINEINDEX_CHUNKSIZE );
+
+        for( uint64_t block = firstblock; block < lastblock; block += chunkblocks ) {
+            if( isstopping.load() ) {
+                return false;
+            }
+
+            uint64_t chunkstart = block * FASTFILE_LINEINDEX_BLOCKSIZE;
+            size_t chunksize = std::min( std::min( lastblock - block, chunkblocks ) * FASTFILE_LINEINDEX_BLOCKSIZE,
+                    filesize - chunkstart );
+            const char* buffer = chunk.data();
+
+            if( filemapping != NULL ) {
+                buffer = filemapping + chunkstart;
+            }
+            else if( !_readrange( filedescriptor, NULL, chunk.data(), chunksize, chunkstart ) ) {
+                return false;
+            }
+
+            for( size_t blockstart = 0; blockstart < chunksize; blockstart += FASTFILE_LINEINDEX_BLOCKSIZE ) {
+                size_t blocksize = std::min( chunksize - blockstart, static_cast<size_t>( FASTFILE_LINEINDEX_BLOCKSIZE ) );
+                blockcounts[block + blockstart / FASTFILE_LINEINDEX_BLOCKSIZE] =
+                        static_cast<uint16_t>( fastfile_countchar( buffer + blockstart, blocksize, '\n' ) );
+            }
+        }
+        return true;
+    }
+
+    bool _findlines(int filedescriptor, const char* filemapping, const std::vector<FastFileLineIndexTarget>& targets,
+            size_t firsttarget, size_t lasttarget)
+    {
+        char blockbuffer[FASTFILE_LINEINDEX_BLOCKSIZE];
+        FastFileScanner newlinescanner;
+
+        for( size_t index = firsttarget; index < lasttarget; ++index ) {
+            const FastFileLineIndexTarget& target = targets[index];
+            uint64_t blockstart = target.block * FASTFILE_LINEINDEX_BLOCKSIZE;
+            size_t blocksize = std::min( filesize - blockstart, static_cast<uint64_t>( FASTFILE_LINEINDEX_BLOCKSIZE ) );
+            const char* buffer = blockbuffer;
+
+            if( filemapping != NULL ) {
+                buffer = filemapping + blockstart;
+            }
+            else if( !_readrange( filedescriptor, NULL, blockbuffer, blocksize, blockstart ) ) {
+                return false;
+            }
+
+            const char* lineend = NULL;
+            newlinescanner.reset( buffer, blocksize );
+
+            for( unsigned int rank = 0; rank < target.rank; ++rank ) {
+                lineend = newlinescanner.next();
+            }
+            offsets[index + 1] = blockstart + ( lineend - buffer ) + 1;
+        }
+        return true;
+    }
+
+    bool _readrange(int filedescriptor, const char* filemapping, char* destination, size_t size, uint64_t offset) {
+        if( filemapping != NULL ) {
+            memcpy( destination, filemapping + offset, size );
+            return true;
+        }
+
+        while( size ) {
+            ssize_t bytesread = pread( filedescriptor, destination, size, offset );
+
+            if( bytesread == -1 && errno == EINTR ) {
+                continue;
+            }
+
+            if( bytesread <= 0 ) {
+                std::cerr << "ERROR: FastFile failed to read the file '" << filepath << "' to index its lines!" << std::endl;
+                return false;
+            }
+
+            destination += bytesread;
+            size -= bytesread;
+            offset += bytesread;
+        }
+        return true;
+    }
+
+#else
+    // Without pread() and mmap(), the index is built by reading the whole file once on this thread
+    bool _scan() {
+        FILE* cfilestream = fopen( filepath.c_str(), "rb" );
+
+        if( cfilestream == NULL ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "' to index its lines!" << std::endl;
+            return false;
+        }
+
+        std::vector<char> chunk( FASTFILE_LINEINDEX_CHUNKSIZE );
+        FastFileScanner newlinescanner;
+
+        offsets.clear();
+        lines = 0;
+        filesize = 0;
+
+        // a line starts after each new line character, except the one ending the file
+        bool haslinestart = true;
+        size_t bytesread;
+
+        while( ( bytesread = fread( chunk.data(), 1, chunk.size(), cfilestream ) ) > 0 ) {
+            if( isstopping.load() ) {
+                fclose( cfilestream );
+                return false;
+            }
+
+            if( haslinestart ) {
+                _pushline( filesize );
+            }
+
+            const char* lineend;
+            newlinescanner.reset( chunk.data(), bytesread );
+
+            while( ( lineend = newlinescanner.next() ) != NULL ) {
+                uint64_t linestart = filesize + ( lineend - chunk.data() ) + 1;
+
+                if( lineend + 1 == chunk.data() + bytesread ) {
+                    haslinestart = true;
+                    break;
+                }
+                _pushline( linestart );
+            }
+            filesize += bytesread;
+
+            // the last chunk line goes on the next chunk
+            if( lineend == NULL ) {
+                haslinestart = false;
+            }
+        }
+
+        bool haserror = ferror( cfilestream );
+        fclose( cfilestream );
+
+        if( haserror ) {
+            std::cerr << "ERROR: FastFile failed to read the file '" << filepath << "' to index its lines!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void _pushline(uint64_t linestart) {
+        if( lines % FASTFILE_LINEINDEX_STEP == 0 ) {
+            offsets.push_back( linestart );
+        }
+        ++lines;
+    }
+#endif
+
+    void _fillheader(FastFileLineIndexHeader& header, const struct stat& filestatus) {
+        memset( &header, 0, sizeof(header) );
+        memcpy( header.magic, FASTFILE_LINEINDEX_MAGIC, sizeof(header.magic) );
+
+        header.inode = filestatus.st_ino;
+        header.size = filestatus.st_size;
+        header.mtime = filestatus.st_mtime;
+        header.ctime = filestatus.st_ctime;
+        fastfile_filetimes( filestatus, header.mtimensec, header.ctimensec );
+        header.step = FASTFILE_LINEINDEX_STEP;
+    }
+
+    bool _load(const struct stat& filestatus) {
+        FILE* indexstream = fopen( indexfile.c_str(), "rb" );
+
+        if( indexstream == NULL ) {
+            return false;
+        }
+
+        FastFileLineIndexHeader expected;
+        FastFileLineIndexHeader header;
+        _fillheader( expected, filestatus );
+
+        bool isvalid = fread( &header, sizeof(header), 1, indexstream ) == 1
+                && memcmp( header.magic, expected.magic, sizeof(header.magic) ) == 0
+                && header.inode == expected.inode
+                && header.size == expected.size
+                && header.mtime == expected.mtime
+                && header.mtimensec == expected.mtimensec
+                && header.ctime == expected.ctime
+                && header.ctimensec == expected.ctimensec
+                && header.step == expected.step
+                && header.entries == ( header.lines + FASTFILE_LINEINDEX_STEP - 1 ) / FASTFILE_LINEINDEX_STEP;
+
+        if( isvalid ) {
+            offsets.resize( header.entries );
+            isvalid = header.entries == 0
+                    || fread( offsets.data(), sizeof(uint64_t), header.entries, indexstream ) == header.entries;
+        }
+
+        fclose( indexstream );
+
+        if( isvalid ) {
+            lines = header.lines;
+            filesize = header.size;
+        }
+        return isvalid;
+    }
+
+    // The index is written on a temporary file renamed over the old one, then, another process
+    // never reads half of it
+    void _save(const struct stat& filestatus) {
+        FastFileLineIndexHeader header;
+        _fillheader( header, filestatus );
+        header.lines = lines;
+        header.entries = offsets.size();
+
+        std::string temporaryfile = indexfile + ".tmp";
+        FILE* indexstream = fopen( temporaryfile.c_str(), "wb" );
+
+        if( indexstream == NULL ) {
+            std::cerr << "ERROR: FastFile failed to create the line index file '" << temporaryfile << "'!" << std::endl;
+            return;
+        }
+
+        bool haswritten = fwrite( &header, sizeof(header), 1, indexstream ) == 1
+                && ( offsets.empty() || fwrite( offsets.data(), sizeof(uint64_t), offsets.size(), indexstream ) == offsets.size() );
+        haswritten = fclose( indexstream ) == 0 && haswritten;
+
+        if( !haswritten || rename( temporaryfile.c_str(), indexfile.c_str() ) != 0 ) {
+            std::cerr << "ERROR: FastFile failed to write the line index file '" << indexfile << "'!" << std::endl;
+            remove( temporaryfile.c_str() );
+        }
+    }
+};
+
+#endif // FASTFILE_APP_LINE_INDEX_H
@@ -0,0 +1,280 @@
+#ifndef FASTFILE_APP_READ_AHEAD_H
+#define FASTFILE_APP_READ_AHEAD_H
+
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "fastfileutf8.h"
+#include "fastfilering.h"
+#include "fastfilesource.h"
+
+#define FASTFILE_READAHEAD_CHUNKSIZE     1048576
+#define FASTFILE_READAHEAD_CHUNKCOUNT    8
+#define FASTFILE_READAHEAD_LINESCAPACITY 65536
+
+// A line already split and trimmed by the producer thread, it is not null terminated
+struct FastFileSpan {
+    const char* line;
+    size_t size;
+    unsigned int chunk;
+    bool hasnewline;
+};
+
+
+/**
+ * Reads the file in big chunks on a native thread, splitting and trimming the lines of each chunk
+ * in place, while the Python thread is busy with the previous lines.
+ *
+ * The chunks are only given back to the producer by release(), then, the consumer can keep using
+ * the lines popped since the last call to release(), except the lines of the last popped chunk.
+ */
+struct FastFileReadAhead {
+    int filedescriptor;
+
+    // The FASTFILE_TRIMUFT8 mode the lines are trimmed with
+    int trimming;
+
+    // The control character the trimming keeps, see fastfile_trimlinekeeping()
+    int keptcharacter;
+
+    // When set, the file is read through it, instead of being read directly
+    FastFileSource* source;
+
+    // With `isfollowing`, a last line without a new line character is not split, as it is still being
+    // written, and `endoffset` is where the producer stopped, i.e., where this line starts
+    bool isfollowing;
+    uint64_t endoffset;
+
+    std::vector<char*> chunks;
+    std::vector<size_t> chunksizes;
+
+    FastFileRing<FastFileSpan> lines;
+    FastFileRing<unsigned int> freechunks;
+
+    unsigned int currentchunk;
+    bool hascurrentchunk;
+    std::vector<unsigned int> heldchunks;
+
+    std::thread producer;
+    bool hasstarted;
+
+    FastFileReadAhead() :
+            filedescriptor(-1),
+            trimming(FASTFILE_TRIMUFT8_DISABLED),
+            keptcharacter(FASTFILE_TRIMUFT8_KEEPNONE),
+            source(NULL),
+            isfollowing(false),
+            endoffset(0),
+            lines(FASTFILE_READAHEAD_LINESCAPACITY, FASTFILE_READAHEAD_LINESCAPACITY / 8),
+            freechunks(FASTFILE_READAHEAD_CHUNKCOUNT),
+            currentchunk(0),
+            hascurrentchunk(false),
+            hasstarted(false)
+    {
+    }
+
+    ~FastFileReadAhead() {
+        stop();
+    }
+
+    bool start(int newfiledescriptor, int newtrimming) {
+        filedescriptor = newfiledescriptor;
+        trimming = newtrimming;
+
+        for( unsigned int index = 0; index < FASTFILE_READAHEAD_CHUNKCOUNT; ++index ) {
+            char* chunk = (char*) malloc( FASTFILE_READAHEAD_CHUNKSIZE );
+
+            if( chunk == NULL ) {
+                return false;
+            }
+
+            chunks.push_back( chunk );
+            chunksizes.push_back( FASTFILE_READAHEAD_CHUNKSIZE );
+            freechunks.push( index );
+        }
+
+        producer = std::thread( &FastFileReadAhead::_produce, this );
+        hasstarted = true;
+        return true;
+    }
+
+    void stop() {
+        if( hasstarted ) {
+            hasstarted = false;
+
+            lines.close();
+            freechunks.close();
+            producer.join();
+        }
+
+        for( char* chunk : chunks ) {
+            free( chunk );
+        }
+        chunks.clear();
+        chunksizes.clear();
+
+        // then, start() can read again from another file offset
+        lines.reset();
+        freechunks.reset();
+        heldchunks.clear();
+        hascurrentchunk = false;
+    }
+
+    // Called by the consumer thread, it blocks while the producer did not split the next line
+    bool pop(FastFileSpan& span) {
+        if( !lines.pop( span ) ) {
+            return false;
+        }
+
+        if( hascurrentchunk && currentchunk != span.chunk ) {
+            heldchunks.push_back( currentchunk );
+        }
+
+        currentchunk = span.chunk;
+        hascurrentchunk = true;
+        return true;
+    }
+
+    // Returns false when pop() would have to wait for the producer
+    bool isready() {
+        return !lines.empty();
+    }
+
+    // Gives back the chunks of all the lines popped so far, except the last popped chunk, which
+    // can still have lines to be popped. The consumer must not block on pop() while holding all the
+    // chunks, otherwise, the producer cannot read the next lines.
+    void release() {
+        for( unsigned int chunk : heldchunks ) {
+            freechunks.push( chunk );
+        }
+        heldchunks.clear();
+    }
+
+    bool _pushline(char* line, size_t size, unsigned int chunk, bool hasnewline) {
+        if( trimming != FASTFILE_TRIMUFT8_DISABLED ) {
+            size = fastfile_trimlinekeeping( trimming, keptcharacter, line, line, size );
+        }
+
+        FastFileSpan span = { line, size, chunk, hasnewline };
+        return lines.push( span );
+    }
+
+    void _produce() {
+        FastFileScanner newlinescanner;
+
+        unsigned int chunk;
+        if( !freechunks.pop( chunk ) ) {
+            lines.close();
+            return;
+        }
+
+        char* buffer = chunks[chunk];
+        char* linestart = buffer;
+        size_t buffersize = 0;
+
+        // the file offset of the buffer start
+        off_t bufferoffset = lseek( filedescriptor, 0, SEEK_CUR );
+        bufferoffset = bufferoffset == -1 ? 0 : bufferoffset;
+
+        while( true ) {
+            // there is no line of this chunk on the ring yet, then, it still can be moved by realloc()
+            if( buffersize >= chunksizes[chunk] ) {
+                size_t newsize = chunksizes[chunk] * 2;
+                char* reallocresult = (char*) realloc( buffer, newsize );
+
+                if( reallocresult == NULL ) {
+                    std::cerr << "ERROR: FastFile failed to alocate the read ahead chunk with size '"
+                            << newsize << "'!" << std::endl;
+                    break;
+                }
+
+                buffer = reallocresult;
+                linestart = buffer;
+                chunks[chunk] = buffer;
+                chunksizes[chunk] = newsize;
+            }
+
+            ssize_t bytesread;
+            do {
+                bytesread = source ? source->read( buffer + buffersize, chunksizes[chunk] - buffersize )
+                        : read( filedescriptor, buffer + buffersize, chunksizes[chunk] - buffersize );
+            }
+            while( bytesread == -1 && errno == EINTR );
+
+            if( bytesread == -1 ) {
+                std::cerr << "ERROR: FastFile failed to read the file with errno '" << errno << "'!" << std::endl;
+                break;
+            }
+
+            if( bytesread == 0 ) {
+                if( linestart != buffer + buffersize && !isfollowing ) {
+                    _pushline( linestart, buffer + buffersize - linestart, chunk, false );
+                    linestart = buffer + buffersize;
+                }
+
+                endoffset = bufferoffset + ( linestart - buffer );
+                break;
+            }
+
+            const char* lineend;
+            newlinescanner.reset( buffer + buffersize, bytesread );
+            buffersize += bytesread;
+
+            while( ( lineend = newlinescanner.next() ) != NULL ) {
+                if( !_pushline( linestart, lineend - linestart, chunk, true ) ) {
+                    return;
+                }
+                linestart = const_cast<char*>( lineend ) + 1;
+            }
+
+            lines.flush();
+
+            // keep reading into the same chunk while none of its lines were pushed
+            if( linestart == buffer ) {
+                continue;
+            }
+
+            // the consumer only gives back a chunk after popping a line from some later chunk,
+            // then, the incomplete last line still can be copied from this chunk
+            unsigned int nextchunk;
+            if( !freechunks.pop( nextchunk ) ) {
+                break;
+            }
+
+            size_t carriedsize = buffer + buffersize - linestart;
+            char* nextbuffer = chunks[nextchunk];
+
+            if( carriedsize >= chunksizes[nextchunk] ) {
+                size_t newsize = ( carriedsize + 1 ) * 2;
+                char* reallocresult = (char*) realloc( nextbuffer, newsize );
+
+                if( reallocresult == NULL ) {
+                    std::cerr << "ERROR: FastFile failed to alocate the read ahead chunk with size '"
+                            << newsize << "'!" << std::endl;
+                    break;
+                }
+
+                nextbuffer = reallocresult;
+                chunks[nextchunk] = nextbuffer;
+                chunksizes[nextchunk] = newsize;
+            }
+
+            memcpy( nextbuffer, linestart, carriedsize );
+            bufferoffset += linestart - buffer;
+            chunk = nextchunk;
+            buffer = nextbuffer;
+            linestart = buffer;
+            buffersize = carriedsize;
+        }
+
+        lines.close();
+    }
+};
+
+#endif // FASTFILE_APP_READ_AHEAD_H
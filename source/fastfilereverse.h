@@ -0,0 +1,137 @@
+#ifndef FASTFILE_APP_REVERSE_H
+#define FASTFILE_APP_REVERSE_H
+
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#define FASTFILE_REVERSE_BLOCKSIZE 65536
+
+/**
+ * Returns the file lines from the last one to the first one, reading the file in blocks backwards
+ * from its end, then, reading the last lines of a big file does not read the whole file.
+ *
+ * `buffer` has the file bytes from `bufferoffset` up to the end of the lines not returned yet, and
+ * a line starting on an earlier block gets this block copied before it. The line returned is only
+ * valid until the next call to previous().
+ */
+struct FastFileReverseReader {
+    std::ifstream fileifstream;
+    std::vector<char> buffer;
+    uint64_t bufferoffset;
+    size_t cursor;
+
+    bool hasfinished;
+    bool islastline;
+    bool haslastnewline;
+
+    FastFileReverseReader() :
+            bufferoffset(0),
+            cursor(0),
+            hasfinished(true),
+            islastline(true),
+            haslastnewline(false)
+    {
+    }
+
+    bool open(const char* filepath) {
+        fileifstream.open( filepath, std::ios::in | std::ios::binary );
+
+        if( fileifstream.fail() ) {
+            std::cerr << "ERROR: FastFile failed to open the file '" << filepath << "'!" << std::endl;
+            return false;
+        }
+
+        fileifstream.seekg( 0, std::ios::end );
+        bufferoffset = static_cast<uint64_t>( fileifstream.tellg() );
+        hasfinished = bufferoffset == 0;
+
+        if( hasfinished ) {
+            return true;
+        }
+
+        if( !_readblock() ) {
+            std::cerr << "ERROR: FastFile failed to read the end of the file '" << filepath << "'!" << std::endl;
+            hasfinished = true;
+            return false;
+        }
+
+        // the new line character ending the file does not start another line
+        haslastnewline = buffer[cursor - 1] == '\n';
+        cursor -= haslastnewline;
+        return true;
+    }
+
+    bool previous(const char*& line, size_t& size, bool& hasnewline) {
+        if( hasfinished ) {
+            return false;
+        }
+
+        size_t linestart = cursor;
+
+        while( true ) {
+            while( linestart && buffer[linestart - 1] != '\n' ) {
+                --linestart;
+            }
+
+            if( linestart || bufferoffset == 0 ) {
+                break;
+            }
+
+            // the line starts on some earlier block, which moves the line after it
+            size_t linesize = cursor;
+            if( !_readblock() ) {
+                std::cerr << "ERROR: FastFile failed to read the file backwards!" << std::endl;
+                hasfinished = true;
+                return false;
+            }
+            linestart = cursor - linesize;
+        }
+
+        line = buffer.data() + linestart;
+        size = cursor - linestart;
+        hasnewline = !islastline || haslastnewline;
+        islastline = false;
+
+        if( linestart ) {
+            cursor = linestart - 1;
+        }
+        else {
+            hasfinished = true;
+        }
+        return true;
+    }
+
+    void close() {
+        if( fileifstream.is_open() ) {
+            fileifstream.close();
+        }
+
+        std::vector<char>().swap( buffer );
+        hasfinished = true;
+    }
+
+    // Reads the block before `bufferoffset` into the buffer start, the blocks grow with the line
+    // being split, then, a long line is not moved again for each block
+    bool _readblock() {
+        size_t blocksize = static_cast<size_t>( std::min( bufferoffset,
+                static_cast<uint64_t>( std::max( cursor, static_cast<size_t>( FASTFILE_REVERSE_BLOCKSIZE ) ) ) ) );
+
+        if( buffer.size() < blocksize + cursor ) {
+            buffer.resize( blocksize + cursor );
+        }
+
+        memmove( buffer.data() + blocksize, buffer.data(), cursor );
+        bufferoffset -= blocksize;
+        cursor += blocksize;
+
+        fileifstream.seekg( bufferoffset );
+        fileifstream.read( buffer.data(), blocksize );
+        return static_cast<size_t>( fileifstream.gcount() ) == blocksize;
+    }
+};
+
+#endif // FASTFILE_APP_REVERSE_H
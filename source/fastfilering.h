@@ -0,0 +1,139 @@
+#ifndef FASTFILE_APP_RING_H
+#define FASTFILE_APP_RING_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <condition_variable>
+
+/**
+ * Single producer and single consumer lock free ring. Its capacity must be a power of two.
+ *
+ * The producer and the consumer only touch their own index, then, a push or a pop does not take
+ * any lock. The mutex and the condition variables are only used to sleep when the ring is full or
+ * empty, and they are only notified when the other side is actually waiting. A waiting consumer is
+ * only woken up after `notifysize` items (or a flush()), and a waiting producer after the ring is
+ * half empty, otherwise, both threads would wake up each other once for each item.
+ */
+template<typename Item>
+struct FastFileRing {
+    std::vector<Item> items;
+    size_t mask;
+    size_t notifysize;
+
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+
+    std::atomic<bool> isclosed;
+    std::atomic<bool> consumerwaiting;
+    std::atomic<bool> producerwaiting;
+
+    std::mutex waitmutex;
+    std::condition_variable consumercondition;
+    std::condition_variable producercondition;
+
+    FastFileRing(size_t capacity, size_t notifysize=1) :
+            items(capacity),
+            mask(capacity - 1),
+            notifysize(notifysize),
+            head(0),
+            tail(0),
+            isclosed(false),
+            consumerwaiting(false),
+            producerwaiting(false)
+    {
+    }
+
+    // The sequentially consistent loads pair with the waiting flags stores, then, one side always
+    // sees either the other side new index or its waiting flag, and no wake up is lost
+    bool empty() {
+        return head.load() == tail.load();
+    }
+
+    bool full() {
+        return tail.load() - head.load() > mask;
+    }
+
+    size_t size() {
+        return tail.load() - head.load();
+    }
+
+    // Blocks while the ring is full, returning false if the ring was closed
+    bool push(const Item& item) {
+        if( full() ) {
+            std::unique_lock<std::mutex> lock( waitmutex );
+            producerwaiting.store( true );
+
+            producercondition.wait( lock, [&]() { return size() <= mask / 2 || isclosed.load(); } );
+            producerwaiting.store( false );
+
+            if( isclosed.load() ) {
+                return false;
+            }
+        }
+
+        size_t position = tail.load( std::memory_order_relaxed );
+        items[position & mask] = item;
+        tail.store( position + 1 );
+
+        if( consumerwaiting.load() && size() >= notifysize ) {
+            std::lock_guard<std::mutex> lock( waitmutex );
+            consumercondition.notify_one();
+        }
+        return true;
+    }
+
+    // Wakes up the consumer for the items pushed so far, it must be called before the producer
+    // blocks on something else than this ring
+    void flush() {
+        if( consumerwaiting.load() ) {
+            std::lock_guard<std::mutex> lock( waitmutex );
+            consumercondition.notify_one();
+        }
+    }
+
+    // Blocks while the ring is empty, returning false if the ring was closed and it is empty
+    bool pop(Item& item) {
+        if( empty() ) {
+            std::unique_lock<std::mutex> lock( waitmutex );
+            consumerwaiting.store( true );
+
+            consumercondition.wait( lock, [&]() { return !empty() || isclosed.load(); } );
+            consumerwaiting.store( false );
+
+            if( empty() ) {
+                return false;
+            }
+        }
+
+        size_t position = head.load( std::memory_order_relaxed );
+        item = items[position & mask];
+        head.store( position + 1 );
+
+        if( producerwaiting.load() && size() <= mask / 2 ) {
+            std::lock_guard<std::mutex> lock( waitmutex );
+            producercondition.notify_one();
+        }
+        return true;
+    }
+
+    // Wakes up both sides, the consumer still can pop all the items pushed before closing it
+    void close() {
+        std::lock_guard<std::mutex> lock( waitmutex );
+        isclosed.store( true );
+
+        consumercondition.notify_all();
+        producercondition.notify_all();
+    }
+
+    // Empties and reopens the ring, only after both sides stopped using it
+    void reset() {
+        head.store( 0 );
+        tail.store( 0 );
+        isclosed.store( false );
+        consumerwaiting.store( false );
+        producerwaiting.store( false );
+    }
+};
+
+#endif // FASTFILE_APP_RING_H
@@ -0,0 +1,542 @@
+#ifndef FASTFILE_APP_SIMD_KERNELS_H
+#define FASTFILE_APP_SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Vectorized kernels shared by all file reading backends.
+//
+// Each kernel has a scalar implementation, which is the reference for the vectorized ones, and
+// SSE2/SSSE3, AVX2 or AVX-512 implementations. The best implementation supported by the running
+// processor is picked once at runtime, then, the same binary works on any x86 machine.
+//
+// https://gcc.gnu.org/onlinedocs/gcc/x86-Built-in-Functions.html
+// https://software.intel.com/sites/landingpage/IntrinsicsGuide/
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define FASTFILE_SIMD_SSE2
+    #include <emmintrin.h>
+
+    #if defined(__GNUC__) || defined(__clang__)
+        #define FASTFILE_SIMD_SSSE3
+        #define FASTFILE_SIMD_AVX2
+        #include <immintrin.h>
+
+        #define FASTFILE_TARGET_SSE2 __attribute__((target("sse2")))
+        #define FASTFILE_TARGET_SSSE3 __attribute__((target("ssse3")))
+        #define FASTFILE_TARGET_AVX2 __attribute__((target("avx2")))
+
+        // __builtin_cpu_supports( "avx512vbmi2" ) requires GCC 8 or Clang 9
+        #if ( defined(__clang__) && __clang_major__ >= 9 ) || ( !defined(__clang__) && __GNUC__ >= 8 )
+            #define FASTFILE_SIMD_AVX512VBMI2
+            #define FASTFILE_TARGET_AVX512VBMI2 __attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+        #endif
+    #else
+        #define FASTFILE_TARGET_SSE2
+    #endif
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+
+// Bit mask of 64 bytes, where the bit `n` is set when the byte `n` of the block matches
+typedef uint64_t (*fastfile_blockmask_function)( const char* block, char character );
+
+static inline unsigned int fastfile_trailingzeros64( uint64_t mask ) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64( &index, mask );
+    return static_cast<unsigned int>( index );
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if( _BitScanForward( &index, static_cast<unsigned long>( mask ) ) ) {
+        return static_cast<unsigned int>( index );
+    }
+    _BitScanForward( &index, static_cast<unsigned long>( mask >> 32 ) );
+    return static_cast<unsigned int>( index ) + 32;
+#else
+    return static_cast<unsigned int>( __builtin_ctzll( mask ) );
+#endif
+}
+
+static inline uint64_t fastfile_charmask64_scalar( const char* block, char character ) {
+    uint64_t mask = 0;
+
+    for( unsigned int index = 0; index < 64; ++index ) {
+        mask |= static_cast<uint64_t>( block[index] == character ) << index;
+    }
+    return mask;
+}
+
+#if defined(FASTFILE_SIMD_SSE2)
+    FASTFILE_TARGET_SSE2
+    static inline uint64_t fastfile_charmask64_sse2( const char* block, char character ) {
+        const __m128i needle = _mm_set1_epi8( character );
+
+        const __m128i chunk0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block ) );
+        const __m128i chunk1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block + 16 ) );
+        const __m128i chunk2 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block + 32 ) );
+        const __m128i chunk3 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block + 48 ) );
+
+        const uint64_t mask0 = static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk0, needle ) ) );
+        const uint64_t mask1 = static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk1, needle ) ) );
+        const uint64_t mask2 = static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk2, needle ) ) );
+        const uint64_t mask3 = static_cast<uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( chunk3, needle ) ) );
+        return mask0 | ( mask1 << 16 ) | ( mask2 << 32 ) | ( mask3 << 48 );
+    }
+#endif
+
+#if defined(FASTFILE_SIMD_AVX2)
+    FASTFILE_TARGET_AVX2
+    static inline uint64_t fastfile_charmask64_avx2( const char* block, char character ) {
+        const __m256i needle = _mm256_set1_epi8( character );
+
+        const __m256i chunk0 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block ) );
+        const __m256i chunk1 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block + 32 ) );
+
+        const uint64_t mask0 = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( chunk0, needle ) ) );
+        const uint64_t mask1 = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( chunk1, needle ) ) );
+        return mask0 | ( mask1 << 32 );
+    }
+#endif
+
+// https://gcc.gnu.org/onlinedocs/gcc/x86-Built-in-Functions.html#index-_005f_005fbuiltin_005fcpu_005fsupports-1
+static inline fastfile_blockmask_function fastfile_charmask64_select() {
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return fastfile_charmask64_avx2;
+    }
+
+    if( __builtin_cpu_supports( "sse2" ) ) {
+        return fastfile_charmask64_sse2;
+    }
+#elif defined(FASTFILE_SIMD_SSE2)
+    return fastfile_charmask64_sse2;
+#endif
+    return fastfile_charmask64_scalar;
+}
+
+
+/**
+ * Iterates over all the positions of a character inside a buffer, computing one bit mask for
+ * each 64 bytes block. Several short lines fit inside one block, then, most calls to next() only
+ * clear the lowest bit of the current mask, instead of searching the buffer again as memchr().
+ */
+struct FastFileScanner {
+    fastfile_blockmask_function charmask;
+    const char* buffer;
+    size_t buffersize;
+    size_t blockoffset;
+    uint64_t mask;
+    char character;
+
+    FastFileScanner(char character='\n') :
+            charmask(fastfile_charmask64_select()),
+            buffer(NULL),
+            buffersize(0),
+            blockoffset(0),
+            mask(0),
+            character(character)
+    {
+    }
+
+    void reset(const char* newbuffer, size_t newbuffersize) {
+        buffer = newbuffer;
+        buffersize = newbuffersize;
+        blockoffset = 0;
+        mask = buffersize ? _blockmask() : 0;
+    }
+
+    // Return a pointer to the next character found or NULL after the buffer end
+    const char* next() {
+        while( !mask ) {
+            blockoffset += 64;
+
+            if( blockoffset >= buffersize ) {
+                blockoffset = buffersize;
+                return NULL;
+            }
+            mask = _blockmask();
+        }
+
+        const char* found = buffer + blockoffset + fastfile_trailingzeros64( mask );
+        mask &= mask - 1;
+        return found;
+    }
+
+    uint64_t _blockmask() {
+        size_t remaining = buffersize - blockoffset;
+
+        if( remaining >= 64 ) {
+            return charmask( buffer + blockoffset, character );
+        }
+
+        // the last block is copied, instead of reading after the buffer end
+        char lastblock[64];
+        memset( lastblock, 0, sizeof( lastblock ) );
+        memcpy( lastblock, buffer + blockoffset, remaining );
+        return charmask( lastblock, character ) & ( ( static_cast<uint64_t>( 1 ) << remaining ) - 1 );
+    }
+};
+
+
+// Returns how many times `character` is found inside the buffer, used to count the file lines
+typedef size_t (*fastfile_countchar_function)( const char* buffer, size_t size, char character );
+
+static inline size_t fastfile_countchar_scalar( const char* buffer, size_t size, char character ) {
+    size_t count = 0;
+
+    for( const char* bufferend = buffer + size; buffer != bufferend; ++buffer ) {
+        count += *buffer == character;
+    }
+    return count;
+}
+
+// Each byte of the accumulator counts up to 255 matches, then, they are summed by _mm_sad_epu8()
+// once every 255 vectors, instead of once for each vector
+#if defined(FASTFILE_SIMD_SSE2)
+    FASTFILE_TARGET_SSE2
+    static inline size_t fastfile_countchar_sse2( const char* buffer, size_t size, char character ) {
+        const __m128i needle = _mm_set1_epi8( character );
+        const __m128i zero = _mm_setzero_si128();
+        __m128i total = _mm_setzero_si128();
+        size_t index = 0;
+
+        while( size - index >= 16 ) {
+            size_t vectors = std::min( ( size - index ) / 16, static_cast<size_t>( 255 ) );
+            __m128i counts = _mm_setzero_si128();
+
+            for( ; vectors; --vectors, index += 16 ) {
+                const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( buffer + index ) );
+                counts = _mm_sub_epi8( counts, _mm_cmpeq_epi8( chunk, needle ) );
+            }
+            total = _mm_add_epi64( total, _mm_sad_epu8( counts, zero ) );
+        }
+
+        uint64_t sums[2];
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( sums ), total );
+        return static_cast<size_t>( sums[0] + sums[1] ) + fastfile_countchar_scalar( buffer + index, size - index, character );
+    }
+#endif
+
+#if defined(FASTFILE_SIMD_AVX2)
+    FASTFILE_TARGET_AVX2
+    static inline size_t fastfile_countchar_avx2( const char* buffer, size_t size, char character ) {
+        const __m256i needle = _mm256_set1_epi8( character );
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i total = _mm256_setzero_si256();
+        size_t index = 0;
+
+        while( size - index >= 32 ) {
+            size_t vectors = std::min( ( size - index ) / 32, static_cast<size_t>( 255 ) );
+            __m256i counts = _mm256_setzero_si256();
+
+            for( ; vectors; --vectors, index += 32 ) {
+                const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( buffer + index ) );
+                counts = _mm256_sub_epi8( counts, _mm256_cmpeq_epi8( chunk, needle ) );
+            }
+            total = _mm256_add_epi64( total, _mm256_sad_epu8( counts, zero ) );
+        }
+
+        uint64_t sums[4];
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( sums ), total );
+        return static_cast<size_t>( sums[0] + sums[1] + sums[2] + sums[3] ) + fastfile_countchar_scalar( buffer + index, size - index, character );
+    }
+#endif
+
+static inline fastfile_countchar_function fastfile_countchar_select() {
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return fastfile_countchar_avx2;
+    }
+
+    if( __builtin_cpu_supports( "sse2" ) ) {
+        return fastfile_countchar_sse2;
+    }
+#elif defined(FASTFILE_SIMD_SSE2)
+    return fastfile_countchar_sse2;
+#endif
+    return fastfile_countchar_scalar;
+}
+
+static inline size_t fastfile_countchar( const char* buffer, size_t size, char character ) {
+    static const fastfile_countchar_function countchar = fastfile_countchar_select();
+    return countchar( buffer, size, character );
+}
+
+
+// Removes all bytes which are not printable ASCII characters, i.e., keeps only `31 < c < 128`,
+// returning the new size. The `destination` can be the same as `source` for in place trimming.
+typedef size_t (*fastfile_printableonly_function)( char* destination, const char* source, size_t size );
+
+static inline bool fastfile_isprintable( char character ) {
+    // as a signed byte, all characters from 128 up to 255 are negative
+    return static_cast<signed char>( character ) > 31;
+}
+
+static inline size_t fastfile_printableonly_scalar( char* destination, const char* source, size_t size ) {
+    const char* sourceend = source + size;
+    char* destinationstart = destination;
+
+    for( ; source != sourceend; ++source ) {
+        if( fastfile_isprintable( *source ) ) {
+            *destination = *source;
+            ++destination;
+        }
+    }
+    return destination - destinationstart;
+}
+
+// Return the size of the longest prefix of `source` only with printable ASCII characters
+typedef size_t (*fastfile_printableprefix_function)( const char* source, size_t size );
+
+static inline size_t fastfile_printableprefix_scalar( const char* source, size_t size ) {
+    size_t index = 0;
+
+    while( index < size && fastfile_isprintable( source[index] ) ) {
+        ++index;
+    }
+    return index;
+}
+
+#if defined(FASTFILE_SIMD_SSE2)
+    FASTFILE_TARGET_SSE2
+    static inline size_t fastfile_printableprefix_sse2( const char* source, size_t size ) {
+        const __m128i lastcontrol = _mm_set1_epi8( 31 );
+        size_t index = 0;
+
+        for( ; size - index >= 16; index += 16 ) {
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source + index ) );
+            const unsigned int mask = _mm_movemask_epi8( _mm_cmpgt_epi8( chunk, lastcontrol ) );
+
+            if( mask != 0xffff ) {
+                return index + fastfile_trailingzeros64( ~mask );
+            }
+        }
+        return index + fastfile_printableprefix_scalar( source + index, size - index );
+    }
+#endif
+
+#if defined(FASTFILE_SIMD_AVX2)
+    FASTFILE_TARGET_AVX2
+    static inline size_t fastfile_printableprefix_avx2( const char* source, size_t size ) {
+        const __m256i lastcontrol = _mm256_set1_epi8( 31 );
+        size_t index = 0;
+
+        for( ; size - index >= 32; index += 32 ) {
+            const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( source + index ) );
+            const uint32_t mask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpgt_epi8( chunk, lastcontrol ) ) );
+
+            if( mask != 0xffffffff ) {
+                return index + fastfile_trailingzeros64( ~mask );
+            }
+        }
+        return index + fastfile_printableprefix_scalar( source + index, size - index );
+    }
+#endif
+
+static inline fastfile_printableprefix_function fastfile_printableprefix_select() {
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return fastfile_printableprefix_avx2;
+    }
+
+    if( __builtin_cpu_supports( "sse2" ) ) {
+        return fastfile_printableprefix_sse2;
+    }
+#elif defined(FASTFILE_SIMD_SSE2)
+    return fastfile_printableprefix_sse2;
+#endif
+    return fastfile_printableprefix_scalar;
+}
+
+static inline size_t fastfile_printableprefix( const char* source, size_t size ) {
+    static const fastfile_printableprefix_function printableprefix = fastfile_printableprefix_select();
+    return printableprefix( source, size );
+}
+
+// Shuffle indexes to move the selected bytes of 8 bytes to the front of them, for each 8 bits mask
+struct FastFileCompressTable {
+    uint8_t indexes[256][8];
+    uint8_t popcount[256];
+
+    FastFileCompressTable() {
+        for( unsigned int mask = 0; mask < 256; ++mask ) {
+            unsigned int count = 0;
+
+            for( unsigned int bit = 0; bit < 8; ++bit ) {
+                if( mask & ( 1u << bit ) ) {
+                    indexes[mask][count] = static_cast<uint8_t>( bit );
+                    ++count;
+                }
+            }
+
+            popcount[mask] = static_cast<uint8_t>( count );
+            for( unsigned int unused = count; unused < 8; ++unused ) {
+                indexes[mask][unused] = 0x80;
+            }
+        }
+    }
+
+    static const FastFileCompressTable& instance() {
+        static const FastFileCompressTable table;
+        return table;
+    }
+};
+
+#if defined(FASTFILE_SIMD_SSSE3)
+    // Writes the selected bytes of the 16 bytes `chunk`, always storing 8 bytes at a time, which is
+    // safe even for in place trimming because `destination` never passes the `chunk` source
+    FASTFILE_TARGET_SSSE3
+    static inline char* fastfile_compress16_ssse3( char* destination, __m128i chunk, unsigned int mask,
+            const FastFileCompressTable& table )
+    {
+        const unsigned int lowmask = mask & 0xff;
+        const unsigned int highmask = mask >> 8;
+
+        const __m128i lowindexes = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( table.indexes[lowmask] ) );
+        const __m128i highindexes = _mm_add_epi8(
+                _mm_loadl_epi64( reinterpret_cast<const __m128i*>( table.indexes[highmask] ) ), _mm_set1_epi8( 8 ) );
+
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( destination ), _mm_shuffle_epi8( chunk, lowindexes ) );
+        destination += table.popcount[lowmask];
+
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( destination ), _mm_shuffle_epi8( chunk, highindexes ) );
+        return destination + table.popcount[highmask];
+    }
+
+    FASTFILE_TARGET_SSSE3
+    static inline size_t fastfile_printableonly_ssse3( char* destination, const char* source, size_t size ) {
+        const FastFileCompressTable& table = FastFileCompressTable::instance();
+        const __m128i lastcontrol = _mm_set1_epi8( 31 );
+
+        const char* sourceend = source + size;
+        char* destinationstart = destination;
+
+        for( ; sourceend - source >= 16; source += 16 ) {
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( source ) );
+            const unsigned int mask = _mm_movemask_epi8( _mm_cmpgt_epi8( chunk, lastcontrol ) );
+
+            // the fast path, all characters are printable, nothing to compact
+            if( mask == 0xffff ) {
+                if( destination != source ) {
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( destination ), chunk );
+                }
+                destination += 16;
+            }
+            else {
+                destination = fastfile_compress16_ssse3( destination, chunk, mask, table );
+            }
+        }
+
+        destination += fastfile_printableonly_scalar( destination, source, sourceend - source );
+        return destination - destinationstart;
+    }
+#endif
+
+#if defined(FASTFILE_SIMD_AVX2)
+    FASTFILE_TARGET_AVX2
+    static inline size_t fastfile_printableonly_avx2( char* destination, const char* source, size_t size ) {
+        const FastFileCompressTable& table = FastFileCompressTable::instance();
+        const __m256i lastcontrol = _mm256_set1_epi8( 31 );
+
+        const char* sourceend = source + size;
+        char* destinationstart = destination;
+
+        for( ; sourceend - source >= 32; source += 32 ) {
+            const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( source ) );
+            const uint32_t mask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpgt_epi8( chunk, lastcontrol ) ) );
+
+            if( mask == 0xffffffff ) {
+                if( destination != source ) {
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( destination ), chunk );
+                }
+                destination += 32;
+            }
+            else {
+                destination = fastfile_compress16_ssse3( destination,
+                        _mm256_castsi256_si128( chunk ), mask & 0xffff, table );
+                destination = fastfile_compress16_ssse3( destination,
+                        _mm256_extracti128_si256( chunk, 1 ), mask >> 16, table );
+            }
+        }
+
+        destination += fastfile_printableonly_scalar( destination, source, sourceend - source );
+        return destination - destinationstart;
+    }
+#endif
+
+#if defined(FASTFILE_SIMD_AVX512VBMI2)
+    // https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html#text=_mm512_mask_compressstoreu_epi8
+    FASTFILE_TARGET_AVX512VBMI2
+    static inline size_t fastfile_printableonly_avx512vbmi2( char* destination, const char* source, size_t size ) {
+        const __m512i lastcontrol = _mm512_set1_epi8( 31 );
+
+        const char* sourceend = source + size;
+        char* destinationstart = destination;
+
+        for( ; sourceend - source >= 64; source += 64 ) {
+            const __m512i chunk = _mm512_loadu_si512( source );
+            const __mmask64 mask = _mm512_cmpgt_epi8_mask( chunk, lastcontrol );
+
+            if( mask == ~static_cast<__mmask64>( 0 ) ) {
+                if( destination != source ) {
+                    _mm512_storeu_si512( destination, chunk );
+                }
+                destination += 64;
+            }
+            else {
+                _mm512_mask_compressstoreu_epi8( destination, mask, chunk );
+                destination += _mm_popcnt_u64( mask );
+            }
+        }
+
+        // the masked load does not read after the source end
+        if( source != sourceend ) {
+            const __mmask64 tailmask = ( static_cast<uint64_t>( 1 ) << ( sourceend - source ) ) - 1;
+            const __m512i chunk = _mm512_maskz_loadu_epi8( tailmask, source );
+            const __mmask64 mask = _mm512_cmpgt_epi8_mask( chunk, lastcontrol ) & tailmask;
+
+            _mm512_mask_compressstoreu_epi8( destination, mask, chunk );
+            destination += _mm_popcnt_u64( mask );
+        }
+        return destination - destinationstart;
+    }
+#endif
+
+static inline fastfile_printableonly_function fastfile_printableonly_select() {
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    #if defined(FASTFILE_SIMD_AVX512VBMI2)
+        if( __builtin_cpu_supports( "avx512vbmi2" ) && __builtin_cpu_supports( "avx512bw" ) ) {
+            return fastfile_printableonly_avx512vbmi2;
+        }
+    #endif
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return fastfile_printableonly_avx2;
+    }
+
+    if( __builtin_cpu_supports( "ssse3" ) ) {
+        return fastfile_printableonly_ssse3;
+    }
+#endif
+    return fastfile_printableonly_scalar;
+}
+
+static inline size_t fastfile_printableonly( char* destination, const char* source, size_t size ) {
+    static const fastfile_printableonly_function printableonly = fastfile_printableonly_select();
+    return printableonly( destination, source, size );
+}
+
+#endif // FASTFILE_APP_SIMD_KERNELS_H
@@ -0,0 +1,19 @@
+#ifndef FASTFILE_APP_SOURCE_H
+#define FASTFILE_APP_SOURCE_H
+
+#include <cstddef>
+#include <sys/types.h>
+
+/**
+ * Where the read ahead thread reads the file bytes from, instead of calling read() on the file,
+ * e.g., the decompressed bytes of a compressed file, or the reads done ahead by io_uring.
+ */
+struct FastFileSource {
+    virtual ~FastFileSource() {
+    }
+
+    // Works like the read() system call, it returns 0 after the last byte and -1 on errors
+    virtual ssize_t read(char* buffer, size_t size) = 0;
+};
+
+#endif // FASTFILE_APP_SOURCE_H
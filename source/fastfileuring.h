@@ -0,0 +1,440 @@
+#ifndef FASTFILE_APP_URING_H
+#define FASTFILE_APP_URING_H
+
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "fastfilesource.h"
+
+// https://man7.org/linux/man-pages/man7/io_uring.7.html
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <sys/syscall.h>
+        #include <linux/io_uring.h>
+
+        #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+            #define FASTFILE_WITH_URING 1
+        #endif
+    #endif
+#endif
+
+#if !defined(FASTFILE_WITH_URING)
+    #define FASTFILE_WITH_URING 0
+#endif
+
+// How many reads are kept in flight at once, and how big each one is
+#define FASTFILE_URING_QUEUEDEPTH 8
+#define FASTFILE_URING_BUFFERSIZE 1048576
+
+/**
+ * Keeps FASTFILE_URING_QUEUEDEPTH reads of the file in flight with io_uring, each one into its
+ * own buffer, which are registered with the kernel when it allows it. read() returns the buffers in
+ * the file order as they complete, and each buffer read is submitted again for the next file range
+ * right after it was copied, then, a cold file is read with several requests at once, instead of
+ * waiting for the disk on each read() call.
+ *
+ * The rings are used directly through the system calls, as liburing is not required. When the
+ * kernel does not allow io_uring, or the file reports no size, as the procfs files, start() returns
+ * false, and the file is read with read(). The reads stop at the file size seen by start(), then,
+ * the bytes written after it are read with pread() until it returns 0.
+ */
+struct FastFileUring : FastFileSource {
+    int filedescriptor;
+    int ringdescriptor;
+
+    uint64_t filesize;
+    uint64_t nextoffset;
+
+    std::vector<char*> buffers;
+    std::vector<uint64_t> bufferoffsets;
+    std::vector<size_t> buffersizes;
+    std::vector<int> bufferresults;
+    std::vector<bool> isinflight;
+    std::vector<bool> isdone;
+
+    unsigned int currentbuffer;
+    size_t buffercursor;
+    bool hascurrentbuffer;
+    bool isregistered;
+
+#if FASTFILE_WITH_URING
+    struct io_uring_params parameters;
+
+    void* submissionring;
+    size_t submissionringsize;
+    void* completionring;
+    size_t completionringsize;
+    struct io_uring_sqe* submissions;
+    size_t submissionssize;
+
+    unsigned* submissionhead;
+    unsigned* submissiontail;
+    unsigned* submissionmask;
+    unsigned* submissionarray;
+    unsigned* completionhead;
+    unsigned* completiontail;
+    unsigned* completionmask;
+    struct io_uring_cqe* completions;
+#endif
+
+    FastFileUring() :
+            filedescriptor(-1),
+            ringdescriptor(-1),
+            filesize(0),
+            nextoffset(0),
+            currentbuffer(0),
+            buffercursor(0),
+            hascurrentbuffer(false),
+            isregistered(false)
+        #if FASTFILE_WITH_URING
+            , submissionring(MAP_FAILED),
+            submissionringsize(0),
+            completionring(MAP_FAILED),
+            completionringsize(0),
+            submissions(static_cast<struct io_uring_sqe*>( MAP_FAILED )),
+            submissionssize(0)
+        #endif
+    {
+    }
+
+    ~FastFileUring() {
+        stop();
+    }
+
+    // Starts reading the file from its current offset, it returns false when io_uring cannot be used
+    bool start(int newfiledescriptor) {
+    #if FASTFILE_WITH_URING
+        filedescriptor = newfiledescriptor;
+
+        struct stat filestatus;
+        off_t fileoffset = lseek( filedescriptor, 0, SEEK_CUR );
+
+        if( fileoffset == -1 || fstat( filedescriptor, &filestatus ) == -1 || !S_ISREG( filestatus.st_mode )
+                || filestatus.st_size == 0 )
+        {
+            return false;
+        }
+
+        filesize = filestatus.st_size;
+        nextoffset = fileoffset;
+
+        if( !_setup() ) {
+            stop();
+            return false;
+        }
+
+        for( unsigned int buffer = 0; buffer < buffers.size(); ++buffer ) {
+            _submit( buffer );
+        }
+        return _enter( 0 );
+    #else
+        return false;
+    #endif
+    }
+
+    void stop() {
+    #if FASTFILE_WITH_URING
+        // the kernel must not write into the buffers after they are freed
+        if( ringdescriptor != -1 ) {
+            while( std::find( isinflight.begin(), isinflight.end(), true ) != isinflight.end() && _enter( 1 ) ) {
+            }
+        }
+
+        if( submissions != MAP_FAILED ) {
+            munmap( submissions, submissionssize );
+            submissions = static_cast<struct io_uring_sqe*>( MAP_FAILED );
+        }
+
+        if( completionring != MAP_FAILED && completionring != submissionring ) {
+            munmap( completionring, completionringsize );
+        }
+        completionring = MAP_FAILED;
+
+        if( submissionring != MAP_FAILED ) {
+            munmap( submissionring, submissionringsize );
+            submissionring = MAP_FAILED;
+        }
+
+        if( ringdescriptor != -1 ) {
+            ::close( ringdescriptor );
+            ringdescriptor = -1;
+        }
+    #endif
+
+        for( char* buffer : buffers ) {
+            free( buffer );
+        }
+
+        buffers.clear();
+        bufferoffsets.clear();
+        buffersizes.clear();
+        bufferresults.clear();
+        isinflight.clear();
+        isdone.clear();
+
+        currentbuffer = 0;
+        buffercursor = 0;
+        hascurrentbuffer = false;
+        isregistered = false;
+    }
+
+    // Called by the read ahead thread, it waits for the next buffer in the file order
+    ssize_t read(char* buffer, size_t size) {
+    #if FASTFILE_WITH_URING
+        while( !hascurrentbuffer || buffercursor == buffersizes[currentbuffer] ) {
+            if( hascurrentbuffer ) {
+                _submit( currentbuffer );
+                currentbuffer = ( currentbuffer + 1 ) % buffers.size();
+                hascurrentbuffer = false;
+
+                if( !_enter( 0 ) ) {
+                    return -1;
+                }
+            }
+
+            // after the file size seen by start(), there is nothing in flight, and the file can still have grown
+            if( !isinflight[currentbuffer] && !isdone[currentbuffer] ) {
+                return _readafterend( buffer, size );
+            }
+
+            while( !isdone[currentbuffer] ) {
+                if( !_enter( 1 ) ) {
+                    return -1;
+                }
+            }
+
+            if( !_complete( currentbuffer ) ) {
+                return -1;
+            }
+
+            buffercursor = 0;
+            hascurrentbuffer = true;
+
+            if( buffersizes[currentbuffer] == 0 ) {
+                return 0;
+            }
+        }
+
+        size_t bytesread = std::min( size, buffersizes[currentbuffer] - buffercursor );
+        memcpy( buffer, buffers[currentbuffer] + buffercursor, bytesread );
+        buffercursor += bytesread;
+        return bytesread;
+    #else
+        return -1;
+    #endif
+    }
+
+#if FASTFILE_WITH_URING
+    bool _setup() {
+        memset( &parameters, 0, sizeof(parameters) );
+        ringdescriptor = static_cast<int>( syscall( __NR_io_uring_setup, FASTFILE_URING_QUEUEDEPTH, &parameters ) );
+
+        if( ringdescriptor == -1 ) {
+            return false;
+        }
+
+        submissionringsize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+        completionringsize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(struct io_uring_cqe);
+
+        // since Linux 5.4, both rings share the same mapping
+        if( parameters.features & IORING_FEAT_SINGLE_MMAP ) {
+            submissionringsize = std::max( submissionringsize, completionringsize );
+            completionringsize = submissionringsize;
+        }
+
+        submissionring = mmap( NULL, submissionringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ringdescriptor, IORING_OFF_SQ_RING );
+
+        if( submissionring == MAP_FAILED ) {
+            return false;
+        }
+
+        if( parameters.features & IORING_FEAT_SINGLE_MMAP ) {
+            completionring = submissionring;
+        }
+        else {
+            completionring = mmap( NULL, completionringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ringdescriptor, IORING_OFF_CQ_RING );
+
+            if( completionring == MAP_FAILED ) {
+                return false;
+            }
+        }
+
+        submissionssize = parameters.sq_entries * sizeof(struct io_uring_sqe);
+        submissions = static_cast<struct io_uring_sqe*>( mmap( NULL, submissionssize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ringdescriptor, IORING_OFF_SQES ) );
+
+        if( submissions == MAP_FAILED ) {
+            return false;
+        }
+
+        char* sqring = static_cast<char*>( submissionring );
+        submissionhead = reinterpret_cast<unsigned*>( sqring + parameters.sq_off.head );
+        submissiontail = reinterpret_cast<unsigned*>( sqring + parameters.sq_off.tail );
+        submissionmask = reinterpret_cast<unsigned*>( sqring + parameters.sq_off.ring_mask );
+        submissionarray = reinterpret_cast<unsigned*>( sqring + parameters.sq_off.array );
+
+        char* cqring = static_cast<char*>( completionring );
+        completionhead = reinterpret_cast<unsigned*>( cqring + parameters.cq_off.head );
+        completiontail = reinterpret_cast<unsigned*>( cqring + parameters.cq_off.tail );
+        completionmask = reinterpret_cast<unsigned*>( cqring + parameters.cq_off.ring_mask );
+        completions = reinterpret_cast<struct io_uring_cqe*>( cqring + parameters.cq_off.cqes );
+
+        std::vector<struct iovec> vectors;
+        for( unsigned int index = 0; index < FASTFILE_URING_QUEUEDEPTH; ++index ) {
+            void* buffer = NULL;
+
+            if( posix_memalign( &buffer, 4096, FASTFILE_URING_BUFFERSIZE ) != 0 ) {
+                return false;
+            }
+
+            buffers.push_back( static_cast<char*>( buffer ) );
+            struct iovec vector = { buffer, FASTFILE_URING_BUFFERSIZE };
+            vectors.push_back( vector );
+        }
+
+        bufferoffsets.resize( buffers.size() );
+        buffersizes.resize( buffers.size() );
+        bufferresults.resize( buffers.size() );
+        isinflight.resize( buffers.size() );
+        isdone.resize( buffers.size() );
+
+        // without enough locked memory allowed, the buffers are just not registered
+        isregistered = syscall( __NR_io_uring_register, ringdescriptor, IORING_REGISTER_BUFFERS,
+                vectors.data(), static_cast<unsigned>( vectors.size() ) ) == 0;
+        return true;
+    }
+
+    // Queues the read of the next file range into the buffer, unless the file end was reached
+    void _submit(unsigned int buffer) {
+        isdone[buffer] = false;
+
+        if( nextoffset >= filesize ) {
+            return;
+        }
+
+        unsigned tail = *submissiontail;
+        unsigned index = tail & *submissionmask;
+        struct io_uring_sqe* submission = &submissions[index];
+
+        size_t readsize = static_cast<size_t>( std::min( filesize - nextoffset, static_cast<uint64_t>( FASTFILE_URING_BUFFERSIZE ) ) );
+        memset( submission, 0, sizeof(*submission) );
+        submission->opcode = isregistered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        submission->fd = filedescriptor;
+        submission->off = nextoffset;
+        submission->addr = reinterpret_cast<uint64_t>( buffers[buffer] );
+        submission->len = static_cast<uint32_t>( readsize );
+        submission->buf_index = isregistered ? buffer : 0;
+        submission->user_data = buffer;
+
+        submissionarray[index] = index;
+        __atomic_store_n( submissiontail, tail + 1, __ATOMIC_RELEASE );
+
+        bufferoffsets[buffer] = nextoffset;
+        buffersizes[buffer] = readsize;
+        isinflight[buffer] = true;
+        nextoffset += readsize;
+    }
+
+    // Submits the queued reads, and waits for at least `waitcount` of them to complete
+    bool _enter(unsigned int waitcount) {
+        unsigned pending = *submissiontail - __atomic_load_n( submissionhead, __ATOMIC_ACQUIRE );
+
+        while( pending || waitcount ) {
+            int result = static_cast<int>( syscall( __NR_io_uring_enter, ringdescriptor, pending, waitcount,
+                    waitcount ? IORING_ENTER_GETEVENTS : 0, NULL, 0 ) );
+
+            if( result == -1 ) {
+                if( errno == EINTR || errno == EAGAIN ) {
+                    continue;
+                }
+                std::cerr << "ERROR: FastFile failed to wait for io_uring with errno '" << errno << "'!" << std::endl;
+                return false;
+            }
+
+            pending -= std::min( pending, static_cast<unsigned>( result ) );
+            break;
+        }
+
+        unsigned head = *completionhead;
+        while( head != __atomic_load_n( completiontail, __ATOMIC_ACQUIRE ) ) {
+            struct io_uring_cqe* completion = &completions[head & *completionmask];
+            unsigned int buffer = static_cast<unsigned int>( completion->user_data );
+
+            bufferresults[buffer] = completion->res;
+            isinflight[buffer] = false;
+            isdone[buffer] = true;
+            ++head;
+        }
+
+        __atomic_store_n( completionhead, head, __ATOMIC_RELEASE );
+        return true;
+    }
+
+    // Reads the bytes after the file size seen by start() with pread(), returning 0 on the file end
+    ssize_t _readafterend(char* buffer, size_t size) {
+        while( true ) {
+            ssize_t preadresult = pread( filedescriptor, buffer, size, nextoffset );
+
+            if( preadresult == -1 && errno == EINTR ) {
+                continue;
+            }
+
+            if( preadresult == -1 ) {
+                std::cerr << "ERROR: FastFile failed to read the file with errno '" << errno << "'!" << std::endl;
+                return -1;
+            }
+
+            nextoffset += preadresult;
+            return preadresult;
+        }
+    }
+
+    // Checks the completed read, the rest of a short read is read with pread()
+    bool _complete(unsigned int buffer) {
+        int result = bufferresults[buffer];
+
+        if( result < 0 ) {
+            std::cerr << "ERROR: FastFile failed to read the file with io_uring with errno '" << -result << "'!" << std::endl;
+            return false;
+        }
+
+        size_t bytesread = result;
+        while( bytesread < buffersizes[buffer] ) {
+            ssize_t preadresult = pread( filedescriptor, buffers[buffer] + bytesread, buffersizes[buffer] - bytesread,
+                    bufferoffsets[buffer] + bytesread );
+
+            if( preadresult == -1 && errno == EINTR ) {
+                continue;
+            }
+
+            if( preadresult == -1 ) {
+                std::cerr << "ERROR: FastFile failed to read the file with errno '" << errno << "'!" << std::endl;
+                return false;
+            }
+
+            // the file was truncated while it was being read
+            if( preadresult == 0 ) {
+                break;
+            }
+            bytesread += preadresult;
+        }
+
+        buffersizes[buffer] = bytesread;
+        return true;
+    }
+#endif
+};
+
+#endif // FASTFILE_APP_URING_H
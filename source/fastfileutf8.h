@@ -0,0 +1,582 @@
+#ifndef FASTFILE_APP_UTF8_H
+#define FASTFILE_APP_UTF8_H
+
+#include "fastfilesimd.h"
+
+// The FASTFILE_TRIMUFT8 modes, the characters removed from each line before it reaches the regex and Python
+#define FASTFILE_TRIMUFT8_DISABLED      0
+#define FASTFILE_TRIMUFT8_PRINTABLEONLY 1
+#define FASTFILE_TRIMUFT8_VALIDUTF8     2
+
+// No control character is kept by fastfile_trimlinekeeping(), see FastFileLineOptions::keptcharacter
+#define FASTFILE_TRIMUFT8_KEEPNONE -1
+
+// Removes the control characters, i.e., `c < 32`, and the invalid UTF-8 sequences, keeping all the
+// valid UTF-8 characters, returning the new size. The `destination` can be the same as `source`
+// for in place trimming. An invalid sequence is dropped one byte at a time, then, the next byte
+// still can start a valid character, as done by Python `bytes.decode( errors="ignore" )`.
+typedef size_t (*fastfile_utf8only_function)( char* destination, const char* source, size_t size );
+
+// Returns the size of the valid UTF-8 character starting at `source`, or zero when its first byte
+// is a control character or it does not start a valid character, see https://datatracker.ietf.org/doc/html/rfc3629#section-4
+static inline unsigned int fastfile_utf8character( const unsigned char* source, size_t size ) {
+    const unsigned char lead = source[0];
+
+    if( lead < 0x80 ) {
+        return lead > 31 ? 1 : 0;
+    }
+
+    unsigned int length;
+    unsigned char lowest = 0x80;
+    unsigned char highest = 0xbf;
+
+    if( lead < 0xc2 ) {
+        return 0;
+    }
+    else if( lead < 0xe0 ) {
+        length = 2;
+    }
+    else if( lead < 0xf0 ) {
+        length = 3;
+        lowest = lead == 0xe0 ? 0xa0 : lowest;
+        highest = lead == 0xed ? 0x9f : highest;
+    }
+    else if( lead < 0xf5 ) {
+        length = 4;
+        lowest = lead == 0xf0 ? 0x90 : lowest;
+        highest = lead == 0xf4 ? 0x8f : highest;
+    }
+    else {
+        return 0;
+    }
+
+    if( size < length || source[1] < lowest || source[1] > highest ) {
+        return 0;
+    }
+
+    for( unsigned int index = 2; index < length; ++index ) {
+        if( ( source[index] & 0xc0 ) != 0x80 ) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+// Trims from `index` until at least `end`, always stopping after a whole character, and returns
+// where it stopped. The characters are copied forward one byte at a time, which is safe in place.
+static inline size_t fastfile_utf8only_until( char*& destination, const char* source, size_t index,
+        size_t end, size_t size )
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( source );
+
+    while( index < end ) {
+        unsigned int length = fastfile_utf8character( bytes + index, size - index );
+
+        if( length == 0 ) {
+            ++index;
+            continue;
+        }
+
+        for( unsigned int byte = 0; byte < length; ++byte ) {
+            *destination = source[index + byte];
+            ++destination;
+        }
+        index += length;
+    }
+    return index;
+}
+
+static inline size_t fastfile_utf8only_scalar( char* destination, const char* source, size_t size ) {
+    char* destinationstart = destination;
+    fastfile_utf8only_until( destination, source, 0, size, size );
+    return destination - destinationstart;
+}
+
+// Return the size of the longest prefix of `source` only with valid UTF-8 and no control characters
+typedef size_t (*fastfile_utf8prefix_function)( const char* source, size_t size );
+
+static inline size_t fastfile_utf8prefix_scalar( const char* source, size_t size ) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( source );
+    size_t index = 0;
+    unsigned int length;
+
+    while( index < size && ( length = fastfile_utf8character( bytes + index, size - index ) ) != 0 ) {
+        index += length;
+    }
+    return index;
+}
+
+// How many bytes at the end of a valid block belong to a character continuing on the next block
+static inline unsigned int fastfile_utf8incomplete( const unsigned char* blockend ) {
+    for( unsigned int back = 1; back <= 3; ++back ) {
+        const unsigned char byte = blockend[-static_cast<int>( back )];
+
+        if( byte >= 0xc0 ) {
+            unsigned int length = byte >= 0xf0 ? 4 : byte >= 0xe0 ? 3 : 2;
+            return length > back ? back : 0;
+        }
+
+        if( byte < 0x80 ) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// The vectorized validation follows "Validating UTF-8 In Less Than One Instruction Per Byte", by
+// John Keiser and Daniel Lemire, https://arxiv.org/abs/2010.03090, which finds all the errors of a
+// block with 3 table lookups on the high and low nibbles of each byte and of its previous byte.
+// Each block starts on a character boundary, then, a character crossing the block end is only
+// validated as part of the next block, which starts on that character.
+#define FASTFILE_UTF8_TOOSHORT     0x01
+#define FASTFILE_UTF8_TOOLONG      0x02
+#define FASTFILE_UTF8_OVERLONG3    0x04
+#define FASTFILE_UTF8_TOOLARGE     0x08
+#define FASTFILE_UTF8_SURROGATE    0x10
+#define FASTFILE_UTF8_OVERLONG2    0x20
+#define FASTFILE_UTF8_TOOLARGE1000 0x40
+#define FASTFILE_UTF8_OVERLONG4    0x40
+#define FASTFILE_UTF8_TWOCONTS     0x80
+#define FASTFILE_UTF8_CARRY        ( FASTFILE_UTF8_TOOSHORT | FASTFILE_UTF8_TOOLONG | FASTFILE_UTF8_TWOCONTS )
+
+// The errors flagged by the high nibble of the previous byte, the low nibble of the previous byte
+// and the high nibble of the byte, a byte is invalid when all the three flag the same error
+#define FASTFILE_UTF8_BYTE1HIGH \
+        FASTFILE_UTF8_TOOLONG, FASTFILE_UTF8_TOOLONG, FASTFILE_UTF8_TOOLONG, FASTFILE_UTF8_TOOLONG, \
+        FASTFILE_UTF8_TOOLONG, FASTFILE_UTF8_TOOLONG, FASTFILE_UTF8_TOOLONG, FASTFILE_UTF8_TOOLONG, \
+        FASTFILE_UTF8_TWOCONTS, FASTFILE_UTF8_TWOCONTS, FASTFILE_UTF8_TWOCONTS, FASTFILE_UTF8_TWOCONTS, \
+        FASTFILE_UTF8_TOOSHORT | FASTFILE_UTF8_OVERLONG2, \
+        FASTFILE_UTF8_TOOSHORT, \
+        FASTFILE_UTF8_TOOSHORT | FASTFILE_UTF8_OVERLONG3 | FASTFILE_UTF8_SURROGATE, \
+        FASTFILE_UTF8_TOOSHORT | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000 | FASTFILE_UTF8_OVERLONG4
+
+#define FASTFILE_UTF8_BYTE1LOW \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_OVERLONG3 | FASTFILE_UTF8_OVERLONG2 | FASTFILE_UTF8_OVERLONG4, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_OVERLONG2, \
+        FASTFILE_UTF8_CARRY, \
+        FASTFILE_UTF8_CARRY, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000 | FASTFILE_UTF8_SURROGATE, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000, \
+        FASTFILE_UTF8_CARRY | FASTFILE_UTF8_TOOLARGE | FASTFILE_UTF8_TOOLARGE1000
+
+#define FASTFILE_UTF8_BYTE2HIGH \
+        FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, \
+        FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, \
+        FASTFILE_UTF8_TOOLONG | FASTFILE_UTF8_OVERLONG2 | FASTFILE_UTF8_TWOCONTS | FASTFILE_UTF8_OVERLONG3 \
+                | FASTFILE_UTF8_TOOLARGE1000 | FASTFILE_UTF8_OVERLONG4, \
+        FASTFILE_UTF8_TOOLONG | FASTFILE_UTF8_OVERLONG2 | FASTFILE_UTF8_TWOCONTS | FASTFILE_UTF8_OVERLONG3 \
+                | FASTFILE_UTF8_TOOLARGE, \
+        FASTFILE_UTF8_TOOLONG | FASTFILE_UTF8_OVERLONG2 | FASTFILE_UTF8_TWOCONTS | FASTFILE_UTF8_SURROGATE \
+                | FASTFILE_UTF8_TOOLARGE, \
+        FASTFILE_UTF8_TOOLONG | FASTFILE_UTF8_OVERLONG2 | FASTFILE_UTF8_TWOCONTS | FASTFILE_UTF8_SURROGATE \
+                | FASTFILE_UTF8_TOOLARGE, \
+        FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT, FASTFILE_UTF8_TOOSHORT
+
+// The bytes greater than these start a character which does not fit before the block end
+#define FASTFILE_UTF8_INCOMPLETE16 \
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, \
+        static_cast<char>( 0xf0 - 1 ), static_cast<char>( 0xe0 - 1 ), static_cast<char>( 0xc0 - 1 )
+
+#if defined(FASTFILE_SIMD_SSSE3)
+    // Returns a non zero byte for each invalid byte of a block starting on a character boundary
+    FASTFILE_TARGET_SSSE3
+    static inline __m128i fastfile_utf8errors_ssse3( __m128i chunk ) {
+        const __m128i byte1high = _mm_setr_epi8( FASTFILE_UTF8_BYTE1HIGH );
+        const __m128i byte1low = _mm_setr_epi8( FASTFILE_UTF8_BYTE1LOW );
+        const __m128i byte2high = _mm_setr_epi8( FASTFILE_UTF8_BYTE2HIGH );
+        const __m128i nibblemask = _mm_set1_epi8( 0x0f );
+
+        // the bytes before the block start are taken as ASCII characters
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i previous1 = _mm_alignr_epi8( chunk, zero, 15 );
+        const __m128i previous2 = _mm_alignr_epi8( chunk, zero, 14 );
+        const __m128i previous3 = _mm_alignr_epi8( chunk, zero, 13 );
+
+        const __m128i specialcases = _mm_and_si128( _mm_and_si128(
+                _mm_shuffle_epi8( byte1high, _mm_and_si128( _mm_srli_epi16( previous1, 4 ), nibblemask ) ),
+                _mm_shuffle_epi8( byte1low, _mm_and_si128( previous1, nibblemask ) ) ),
+                _mm_shuffle_epi8( byte2high, _mm_and_si128( _mm_srli_epi16( chunk, 4 ), nibblemask ) ) );
+
+        // the third and fourth bytes of a character must be continuations, which only TWOCONTS flags
+        const __m128i isthirdbyte = _mm_subs_epu8( previous2, _mm_set1_epi8( static_cast<char>( 0xe0 - 0x80 ) ) );
+        const __m128i isfourthbyte = _mm_subs_epu8( previous3, _mm_set1_epi8( static_cast<char>( 0xf0 - 0x80 ) ) );
+        const __m128i mustbecontinuation = _mm_and_si128( _mm_or_si128( isthirdbyte, isfourthbyte ),
+                _mm_set1_epi8( static_cast<char>( 0x80 ) ) );
+
+        return _mm_xor_si128( mustbecontinuation, specialcases );
+    }
+
+    FASTFILE_TARGET_SSSE3
+    static inline bool fastfile_iszero_ssse3( __m128i chunk ) {
+        return _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, _mm_setzero_si128() ) ) == 0xffff;
+    }
+
+    FASTFILE_TARGET_SSSE3
+    static inline bool fastfile_utf8isvalid_ssse3( __m128i chunk ) {
+        return fastfile_iszero_ssse3( fastfile_utf8errors_ssse3( chunk ) );
+    }
+
+    // Validates the last bytes, fewer than a block, as a whole block padded with spaces
+    FASTFILE_TARGET_SSSE3
+    static inline bool fastfile_utf8tailisvalid_ssse3( const char* source, size_t size ) {
+        char padded[16];
+        memset( padded, ' ', sizeof(padded) );
+        memcpy( padded, source, size );
+
+        const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( padded ) );
+        const unsigned int nonasciimask = _mm_movemask_epi8( chunk );
+        const unsigned int printablemask = _mm_movemask_epi8( _mm_cmpgt_epi8( chunk, _mm_set1_epi8( 31 ) ) );
+
+        return ( nonasciimask | printablemask ) == 0xffff && ( nonasciimask == 0 || fastfile_utf8isvalid_ssse3( chunk ) );
+    }
+
+    FASTFILE_TARGET_SSSE3
+    static inline size_t fastfile_utf8only_ssse3( char* destination, const char* source, size_t size ) {
+        const FastFileCompressTable& table = FastFileCompressTable::instance();
+        const __m128i lastcontrol = _mm_set1_epi8( 31 );
+        const __m128i incomplete = _mm_setr_epi8( FASTFILE_UTF8_INCOMPLETE16 );
+
+        char* destinationstart = destination;
+        size_t index = 0;
+
+        while( size - index >= 16 ) {
+            const char* block = source + index;
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block ) );
+
+            // as signed bytes, all the bytes from 128 up to 255 are negative
+            const unsigned int nonasciimask = _mm_movemask_epi8( chunk );
+            const unsigned int printablemask = _mm_movemask_epi8( _mm_cmpgt_epi8( chunk, lastcontrol ) );
+            unsigned int blocksize = 16;
+
+            // out of the fast path, where all characters are printable ASCII, the ASCII control
+            // characters are removed as by fastfile_printableonly(), while the other blocks are
+            // validated, and trimmed one character at a time when they have some invalid byte
+            if( nonasciimask != 0 || printablemask != 0xffff ) {
+                if( nonasciimask == 0 ) {
+                    destination = fastfile_compress16_ssse3( destination, chunk, printablemask, table );
+                    index += 16;
+                    continue;
+                }
+
+                if( ( nonasciimask | printablemask ) != 0xffff || !fastfile_utf8isvalid_ssse3( chunk ) ) {
+                    index = fastfile_utf8only_until( destination, source, index, index + 16, size );
+                    continue;
+                }
+
+                if( !fastfile_iszero_ssse3( _mm_subs_epu8( chunk, incomplete ) ) ) {
+                    blocksize -= fastfile_utf8incomplete( reinterpret_cast<const unsigned char*>( block ) + 16 );
+                }
+            }
+
+            // the last character bytes are written again with the next block, but they cannot be
+            // written over the next block bytes before it is loaded
+            if( destination != block ) {
+                if( blocksize == 16 || static_cast<size_t>( block - destination ) >= 16 - blocksize ) {
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( destination ), chunk );
+                }
+                else {
+                    memmove( destination, block, blocksize );
+                }
+            }
+
+            destination += blocksize;
+            index += blocksize;
+        }
+
+        // the last characters are only trimmed one at a time when they are not all valid
+        if( index < size && fastfile_utf8tailisvalid_ssse3( source + index, size - index ) ) {
+            memmove( destination, source + index, size - index );
+            destination += size - index;
+            index = size;
+        }
+
+        fastfile_utf8only_until( destination, source, index, size, size );
+        return destination - destinationstart;
+    }
+
+    FASTFILE_TARGET_SSSE3
+    static inline size_t fastfile_utf8prefix_ssse3( const char* source, size_t size ) {
+        const __m128i lastcontrol = _mm_set1_epi8( 31 );
+        const __m128i incomplete = _mm_setr_epi8( FASTFILE_UTF8_INCOMPLETE16 );
+        size_t index = 0;
+
+        while( size - index >= 16 ) {
+            const char* block = source + index;
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block ) );
+
+            const unsigned int nonasciimask = _mm_movemask_epi8( chunk );
+            const unsigned int printablemask = _mm_movemask_epi8( _mm_cmpgt_epi8( chunk, lastcontrol ) );
+
+            index += 16;
+
+            if( nonasciimask != 0 || printablemask != 0xffff ) {
+                if( ( nonasciimask | printablemask ) != 0xffff || !fastfile_utf8isvalid_ssse3( chunk ) ) {
+                    index -= 16;
+                    break;
+                }
+
+                if( !fastfile_iszero_ssse3( _mm_subs_epu8( chunk, incomplete ) ) ) {
+                    index -= fastfile_utf8incomplete( reinterpret_cast<const unsigned char*>( block ) + 16 );
+                }
+            }
+        }
+        if( size - index < 16 && fastfile_utf8tailisvalid_ssse3( source + index, size - index ) ) {
+            return size;
+        }
+        return index + fastfile_utf8prefix_scalar( source + index, size - index );
+    }
+#endif
+
+#if defined(FASTFILE_SIMD_AVX2)
+    FASTFILE_TARGET_AVX2
+    static inline __m256i fastfile_utf8errors_avx2( __m256i chunk ) {
+        const __m256i byte1high = _mm256_broadcastsi128_si256( _mm_setr_epi8( FASTFILE_UTF8_BYTE1HIGH ) );
+        const __m256i byte1low = _mm256_broadcastsi128_si256( _mm_setr_epi8( FASTFILE_UTF8_BYTE1LOW ) );
+        const __m256i byte2high = _mm256_broadcastsi128_si256( _mm_setr_epi8( FASTFILE_UTF8_BYTE2HIGH ) );
+        const __m256i nibblemask = _mm256_set1_epi8( 0x0f );
+
+        // the high lane previous bytes are on the low lane, while the low lane ones are zeros
+        const __m256i lowlane = _mm256_permute2x128_si256( chunk, chunk, 0x08 );
+        const __m256i previous1 = _mm256_alignr_epi8( chunk, lowlane, 15 );
+        const __m256i previous2 = _mm256_alignr_epi8( chunk, lowlane, 14 );
+        const __m256i previous3 = _mm256_alignr_epi8( chunk, lowlane, 13 );
+
+        const __m256i specialcases = _mm256_and_si256( _mm256_and_si256(
+                _mm256_shuffle_epi8( byte1high, _mm256_and_si256( _mm256_srli_epi16( previous1, 4 ), nibblemask ) ),
+                _mm256_shuffle_epi8( byte1low, _mm256_and_si256( previous1, nibblemask ) ) ),
+                _mm256_shuffle_epi8( byte2high, _mm256_and_si256( _mm256_srli_epi16( chunk, 4 ), nibblemask ) ) );
+
+        const __m256i isthirdbyte = _mm256_subs_epu8( previous2, _mm256_set1_epi8( static_cast<char>( 0xe0 - 0x80 ) ) );
+        const __m256i isfourthbyte = _mm256_subs_epu8( previous3, _mm256_set1_epi8( static_cast<char>( 0xf0 - 0x80 ) ) );
+        const __m256i mustbecontinuation = _mm256_and_si256( _mm256_or_si256( isthirdbyte, isfourthbyte ),
+                _mm256_set1_epi8( static_cast<char>( 0x80 ) ) );
+
+        return _mm256_xor_si256( mustbecontinuation, specialcases );
+    }
+
+    FASTFILE_TARGET_AVX2
+    static inline bool fastfile_iszero_avx2( __m256i chunk ) {
+        return _mm256_testz_si256( chunk, chunk );
+    }
+
+    FASTFILE_TARGET_AVX2
+    static inline bool fastfile_utf8isvalid_avx2( __m256i chunk ) {
+        return fastfile_iszero_avx2( fastfile_utf8errors_avx2( chunk ) );
+    }
+
+    FASTFILE_TARGET_AVX2
+    static inline __m256i fastfile_utf8incomplete_avx2() {
+        return _mm256_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                FASTFILE_UTF8_INCOMPLETE16 );
+    }
+
+    // Validates the last bytes, fewer than a block, as a whole block padded with spaces
+    FASTFILE_TARGET_AVX2
+    static inline bool fastfile_utf8tailisvalid_avx2( const char* source, size_t size ) {
+        char padded[32];
+        memset( padded, ' ', sizeof(padded) );
+        memcpy( padded, source, size );
+
+        const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( padded ) );
+        const uint32_t nonasciimask = static_cast<uint32_t>( _mm256_movemask_epi8( chunk ) );
+        const uint32_t printablemask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpgt_epi8( chunk, _mm256_set1_epi8( 31 ) ) ) );
+
+        return ( nonasciimask | printablemask ) == 0xffffffff && ( nonasciimask == 0 || fastfile_utf8isvalid_avx2( chunk ) );
+    }
+
+    FASTFILE_TARGET_AVX2
+    static inline size_t fastfile_utf8only_avx2( char* destination, const char* source, size_t size ) {
+        const FastFileCompressTable& table = FastFileCompressTable::instance();
+        const __m256i lastcontrol = _mm256_set1_epi8( 31 );
+        const __m256i incomplete = fastfile_utf8incomplete_avx2();
+
+        char* destinationstart = destination;
+        size_t index = 0;
+
+        while( size - index >= 32 ) {
+            const char* block = source + index;
+            const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block ) );
+
+            const uint32_t nonasciimask = static_cast<uint32_t>( _mm256_movemask_epi8( chunk ) );
+            const uint32_t printablemask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpgt_epi8( chunk, lastcontrol ) ) );
+            unsigned int blocksize = 32;
+
+            if( nonasciimask != 0 || printablemask != 0xffffffff ) {
+                if( nonasciimask == 0 ) {
+                    destination = fastfile_compress16_ssse3( destination,
+                            _mm256_castsi256_si128( chunk ), printablemask & 0xffff, table );
+                    destination = fastfile_compress16_ssse3( destination,
+                            _mm256_extracti128_si256( chunk, 1 ), printablemask >> 16, table );
+                    index += 32;
+                    continue;
+                }
+
+                if( ( nonasciimask | printablemask ) != 0xffffffff || !fastfile_utf8isvalid_avx2( chunk ) ) {
+                    index = fastfile_utf8only_until( destination, source, index, index + 32, size );
+                    continue;
+                }
+
+                if( !fastfile_iszero_avx2( _mm256_subs_epu8( chunk, incomplete ) ) ) {
+                    blocksize -= fastfile_utf8incomplete( reinterpret_cast<const unsigned char*>( block ) + 32 );
+                }
+            }
+
+            if( destination != block ) {
+                if( blocksize == 32 || static_cast<size_t>( block - destination ) >= 32 - blocksize ) {
+                    _mm256_storeu_si256( reinterpret_cast<__m256i*>( destination ), chunk );
+                }
+                else {
+                    memmove( destination, block, blocksize );
+                }
+            }
+
+            destination += blocksize;
+            index += blocksize;
+        }
+
+        // the last characters are only trimmed one at a time when they are not all valid
+        if( index < size && fastfile_utf8tailisvalid_avx2( source + index, size - index ) ) {
+            memmove( destination, source + index, size - index );
+            destination += size - index;
+            index = size;
+        }
+
+        fastfile_utf8only_until( destination, source, index, size, size );
+        return destination - destinationstart;
+    }
+
+    FASTFILE_TARGET_AVX2
+    static inline size_t fastfile_utf8prefix_avx2( const char* source, size_t size ) {
+        const __m256i lastcontrol = _mm256_set1_epi8( 31 );
+        const __m256i incomplete = fastfile_utf8incomplete_avx2();
+        size_t index = 0;
+
+        while( size - index >= 32 ) {
+            const char* block = source + index;
+            const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block ) );
+
+            const uint32_t nonasciimask = static_cast<uint32_t>( _mm256_movemask_epi8( chunk ) );
+            const uint32_t printablemask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_cmpgt_epi8( chunk, lastcontrol ) ) );
+
+            index += 32;
+
+            if( nonasciimask != 0 || printablemask != 0xffffffff ) {
+                if( ( nonasciimask | printablemask ) != 0xffffffff || !fastfile_utf8isvalid_avx2( chunk ) ) {
+                    index -= 32;
+                    break;
+                }
+
+                if( !fastfile_iszero_avx2( _mm256_subs_epu8( chunk, incomplete ) ) ) {
+                    index -= fastfile_utf8incomplete( reinterpret_cast<const unsigned char*>( block ) + 32 );
+                }
+            }
+        }
+        if( size - index < 32 && fastfile_utf8tailisvalid_avx2( source + index, size - index ) ) {
+            return size;
+        }
+        return index + fastfile_utf8prefix_scalar( source + index, size - index );
+    }
+#endif
+
+static inline fastfile_utf8only_function fastfile_utf8only_select() {
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return fastfile_utf8only_avx2;
+    }
+
+    if( __builtin_cpu_supports( "ssse3" ) ) {
+        return fastfile_utf8only_ssse3;
+    }
+#endif
+    return fastfile_utf8only_scalar;
+}
+
+static inline size_t fastfile_utf8only( char* destination, const char* source, size_t size ) {
+    static const fastfile_utf8only_function utf8only = fastfile_utf8only_select();
+    return utf8only( destination, source, size );
+}
+
+static inline fastfile_utf8prefix_function fastfile_utf8prefix_select() {
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        return fastfile_utf8prefix_avx2;
+    }
+
+    if( __builtin_cpu_supports( "ssse3" ) ) {
+        return fastfile_utf8prefix_ssse3;
+    }
+#endif
+    return fastfile_utf8prefix_scalar;
+}
+
+static inline size_t fastfile_utf8prefix( const char* source, size_t size ) {
+    static const fastfile_utf8prefix_function utf8prefix = fastfile_utf8prefix_select();
+    return utf8prefix( source, size );
+}
+
+// Removes the characters dropped by the FASTFILE_TRIMUFT8 `mode`, returning the new size
+static inline size_t fastfile_trimline( int mode, char* destination, const char* source, size_t size ) {
+    return mode == FASTFILE_TRIMUFT8_VALIDUTF8 ? fastfile_utf8only( destination, source, size )
+            : fastfile_printableonly( destination, source, size );
+}
+
+// Returns the size of the longest prefix of `source` without any character dropped by the `mode`
+static inline size_t fastfile_trimmedprefix( int mode, const char* source, size_t size ) {
+    return mode == FASTFILE_TRIMUFT8_VALIDUTF8 ? fastfile_utf8prefix( source, size )
+            : fastfile_printableprefix( source, size );
+}
+
+// Returns the fields `delimiter` when the `mode` would drop it, as the tab character, otherwise, FASTFILE_TRIMUFT8_KEEPNONE
+static inline int fastfile_keptcharacter( int mode, char delimiter ) {
+    return mode != FASTFILE_TRIMUFT8_DISABLED && delimiter >= 0 && delimiter < 32 ? delimiter : FASTFILE_TRIMUFT8_KEEPNONE;
+}
+
+// As fastfile_trimline(), but keeping the `kept` control character, e.g., the tab character of the
+// fields delimiter, by trimming the pieces of the line between them one by one. It is also safe in
+// place, as each piece is written before the start of the next one.
+static inline size_t fastfile_trimlinekeeping( int mode, int kept, char* destination, const char* source, size_t size ) {
+    if( kept == FASTFILE_TRIMUFT8_KEEPNONE ) {
+        return fastfile_trimline( mode, destination, source, size );
+    }
+
+    const char* end = source + size;
+    size_t trimmedsize = 0;
+
+    while( true ) {
+        const char* found = static_cast<const char*>( memchr( source, kept, end - source ) );
+        const char* pieceend = found ? found : end;
+        trimmedsize += fastfile_trimline( mode, destination + trimmedsize, source, pieceend - source );
+
+        if( found == NULL ) {
+            return trimmedsize;
+        }
+
+        destination[trimmedsize++] = static_cast<char>( kept );
+        source = found + 1;
+    }
+}
+
+// As fastfile_trimmedprefix(), but the `kept` control character does not end the prefix
+static inline size_t fastfile_trimmedprefixkeeping( int mode, int kept, const char* source, size_t size ) {
+    size_t prefix = fastfile_trimmedprefix( mode, source, size );
+
+    while( kept != FASTFILE_TRIMUFT8_KEEPNONE && prefix < size && source[prefix] == static_cast<char>( kept ) ) {
+        prefix += 1 + fastfile_trimmedprefix( mode, source + prefix + 1, size - prefix - 1 );
+    }
+    return prefix;
+}
+
+#endif // FASTFILE_APP_UTF8_H
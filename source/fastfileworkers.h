@@ -0,0 +1,102 @@
+#ifndef FASTFILE_APP_WORKERS_H
+#define FASTFILE_APP_WORKERS_H
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+/**
+ * A fixed pool of native threads which all run the same job over their own slice of some data.
+ *
+ * The thread calling run() also works as the worker 0, then, a pool with `threadcount` workers
+ * only starts `threadcount - 1` threads, and run() only returns after all workers finished the job.
+ */
+struct FastFileWorkers {
+    std::vector<std::thread> threads;
+    std::function<void(unsigned int)> job;
+
+    std::mutex jobmutex;
+    std::condition_variable startcondition;
+    std::condition_variable donecondition;
+
+    unsigned long long generation;
+    unsigned int pendingworkers;
+    bool isstopping;
+
+    FastFileWorkers() :
+            generation(0),
+            pendingworkers(0),
+            isstopping(false)
+    {
+    }
+
+    ~FastFileWorkers() {
+        stop();
+    }
+
+    unsigned int size() {
+        return threads.size() + 1;
+    }
+
+    void start(unsigned int threadcount) {
+        for( unsigned int worker = 1; worker < threadcount; ++worker ) {
+            threads.push_back( std::thread( &FastFileWorkers::_work, this, worker ) );
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock( jobmutex );
+            isstopping = true;
+        }
+        startcondition.notify_all();
+
+        for( std::thread& thread : threads ) {
+            thread.join();
+        }
+        threads.clear();
+    }
+
+    // Calls `newjob( worker )` once for each worker, and waits for all of them
+    void run(const std::function<void(unsigned int)>& newjob) {
+        {
+            std::lock_guard<std::mutex> lock( jobmutex );
+            job = newjob;
+            pendingworkers = threads.size();
+            ++generation;
+        }
+        startcondition.notify_all();
+
+        job( 0 );
+
+        std::unique_lock<std::mutex> lock( jobmutex );
+        donecondition.wait( lock, [&]() { return pendingworkers == 0; } );
+    }
+
+    void _work(unsigned int worker) {
+        unsigned long long lastgeneration = 0;
+
+        while( true ) {
+            {
+                std::unique_lock<std::mutex> lock( jobmutex );
+                startcondition.wait( lock, [&]() { return isstopping || generation != lastgeneration; } );
+
+                if( isstopping ) {
+                    return;
+                }
+                lastgeneration = generation;
+            }
+
+            job( worker );
+
+            std::lock_guard<std::mutex> lock( jobmutex );
+            if( --pendingworkers == 0 ) {
+                donecondition.notify_one();
+            }
+        }
+    }
+};
+
+#endif // FASTFILE_APP_WORKERS_H
@@ -10,6 +10,10 @@ typedef struct
 {
     PyObject_HEAD
     FastFile* cppobjectpointer;
+
+    // the constructor arguments, reversed() opens the same file again with them
+    PyObject* args;
+    PyObject* kwargs;
 }
 PyFastFile;
 
@@ -29,35 +33,301 @@ static PyModuleDef fastfilepackagemodule =
     NULL, /* freefunc m_free */
 };
 
+// Fills the fields() options from the fields() or the constructor arguments, returning false with
+// ValueError when they are not valid
+static bool PyFastFile_fieldoptions(int delimiter, PyObject* quote, PyObject* columns, PyObject* types, int mode,
+        FastFileFieldOptions& fieldoptions)
+{
+    if( delimiter > 127 ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile fields delimiter must be an ASCII character" );
+        return false;
+    }
+
+    if( mode == FASTFILE_MODE_VIEW ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile fields do not support the view mode" );
+        return false;
+    }
+    fieldoptions.delimiter = static_cast<char>( delimiter );
+
+    if( quote != Py_None ) {
+        if( !PyUnicode_Check( quote ) || PyUnicode_GET_LENGTH( quote ) != 1 || PyUnicode_READ_CHAR( quote, 0 ) > 127
+                || PyUnicode_READ_CHAR( quote, 0 ) == static_cast<Py_UCS4>( delimiter ) )
+        {
+            PyErr_SetString( PyExc_ValueError, "FastFile fields quote must be an ASCII character other than the delimiter" );
+            return false;
+        }
+        fieldoptions.quote = static_cast<char>( PyUnicode_READ_CHAR( quote, 0 ) );
+        fieldoptions.hasquote = true;
+    }
+
+    if( columns != Py_None ) {
+        PyObject* sequence = PySequence_Fast( columns, "FastFile fields columns must be a list of column indexes" );
+
+        if( sequence == NULL ) {
+            return false;
+        }
+
+        for( Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE( sequence ); ++index ) {
+            Py_ssize_t column = PyNumber_AsSsize_t( PySequence_Fast_GET_ITEM( sequence, index ), PyExc_OverflowError );
+
+            if( column < 0 ) {
+                if( !PyErr_Occurred() ) {
+                    PyErr_SetString( PyExc_ValueError, "FastFile fields columns must be zero or positive column indexes" );
+                }
+                Py_DECREF( sequence );
+                return false;
+            }
+            fieldoptions.columns.push_back( column );
+        }
+        Py_DECREF( sequence );
+
+        if( fieldoptions.columns.empty() ) {
+            PyErr_SetString( PyExc_ValueError, "FastFile fields columns must have at least one column index" );
+            return false;
+        }
+    }
+
+    if( types != Py_None ) {
+        PyObject* sequence = PyUnicode_Check( types ) ? NULL
+                : PySequence_Fast( types, "FastFile fields types must be a list of type names" );
+
+        if( sequence == NULL ) {
+            if( !PyErr_Occurred() ) {
+                PyErr_SetString( PyExc_TypeError, "FastFile fields types must be a list of type names" );
+            }
+            return false;
+        }
+
+        for( Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE( sequence ); ++index ) {
+            PyObject* item = PySequence_Fast_GET_ITEM( sequence, index );
+            const char* name = PyUnicode_Check( item ) ? PyUnicode_AsUTF8( item ) : NULL;
+            int type = name ? fastfile_findoption( fastfile_types, name ) : -1;
+
+            if( type < 0 ) {
+                if( !PyErr_Occurred() ) {
+                    PyErr_Format( PyExc_ValueError, "FastFile type '%S' is not available, see fastfilepackage.TYPES", item );
+                }
+                Py_DECREF( sequence );
+                return false;
+            }
+            fieldoptions.types.push_back( type );
+        }
+        Py_DECREF( sequence );
+
+        // without columns, the types are for the first fields
+        for( size_t column = 0; columns == Py_None && column < fieldoptions.types.size(); ++column ) {
+            fieldoptions.columns.push_back( column );
+        }
+
+        if( fieldoptions.types.size() != fieldoptions.columns.size() ) {
+            PyErr_SetString( PyExc_ValueError, "FastFile fields types must have one type for each column" );
+            return false;
+        }
+    }
+    return true;
+}
+
 // initialize PyFastFile Object
 static int PyFastFile_init(PyFastFile* self, PyObject* args, PyObject* kwargs) {
     char* filepath;
-    char* rawregex;
+    PyObject* rawregex = NULL;
+    const char* backendname = NULL;
+    const char* enginename = NULL;
+    const char* modename = NULL;
+    Py_ssize_t dedup = 0;
+    int lineindex = 0;
+    const char* indexfile = NULL;
+    int follow = 0;
+    int delimiter = -1;
+    PyObject* quote = Py_None;
+    PyObject* columns = Py_None;
+    PyObject* types = Py_None;
+
+    static char* kwlist[] = {
+        const_cast<char*>( "filepath" ),
+        const_cast<char*>( "rawregex" ),
+        const_cast<char*>( "backend" ),
+        const_cast<char*>( "engine" ),
+        const_cast<char*>( "mode" ),
+        const_cast<char*>( "dedup" ),
+        const_cast<char*>( "lineindex" ),
+        const_cast<char*>( "indexfile" ),
+        const_cast<char*>( "follow" ),
+        const_cast<char*>( "delimiter" ),
+        const_cast<char*>( "quote" ),
+        const_cast<char*>( "columns" ),
+        const_cast<char*>( "types" ),
+        NULL
+    };
+
+    if( !PyArg_ParseTupleAndKeywords( args, kwargs, "s|OzzznpzpCOOO", kwlist, &filepath, &rawregex, &backendname, &enginename, &modename, &dedup,
+            &lineindex, &indexfile, &follow, &delimiter, &quote, &columns, &types ) )
+    {
+        return -1;
+    }
+
+    // without the keywords, the backend and the engine picked when the module was built are used
+    int backend = backendname ? fastfile_findoption( fastfile_backends, backendname ) : FASTFILE_DEFAULTBACKEND;
+    int engine = enginename ? fastfile_findoption( fastfile_engines, enginename ) : FASTFILE_DEFAULTENGINE;
+    int mode = modename ? fastfile_findoption( fastfile_modes, modename ) : FASTFILE_MODE_TEXT;
+
+    if( backend < 0 ) {
+        PyErr_Format( PyExc_ValueError, "FastFile backend '%s' is not available, see fastfilepackage.BACKENDS", backendname );
+        return -1;
+    }
 
-    char empty[] = "";
-    static char* kwlist[] = { empty, empty, NULL };
+    if( engine < 0 ) {
+        PyErr_Format( PyExc_ValueError, "FastFile engine '%s' is not available, see fastfilepackage.ENGINES", enginename );
+        return -1;
+    }
+
+    if( mode < 0 ) {
+        PyErr_Format( PyExc_ValueError, "FastFile mode '%s' is not available, see fastfilepackage.MODES", modename );
+        return -1;
+    }
 
-    if( !PyArg_ParseTupleAndKeywords( args, kwargs, "s|s", kwlist, &filepath, &rawregex ) ) {
+#if defined(__unix__)
+    // the compressed files are only read by the read ahead backend, as they are decompressed on its thread
+    int compression = fastfile_compression( filepath );
+
+    if( compression != FASTFILE_COMPRESSION_NONE ) {
+        if( !fastfile_hasdecompressor( compression ) ) {
+            PyErr_Format( PyExc_ValueError, "FastFile was built without the %s library to read the file '%s'",
+                    fastfile_compressionname( compression ), filepath );
+            return -1;
+        }
+
+        if( lineindex || indexfile || follow ) {
+            PyErr_Format( PyExc_ValueError, "FastFile %s compressed file '%s' does not support a line index or follow",
+                    fastfile_compressionname( compression ), filepath );
+            return -1;
+        }
+        backend = FASTFILE_GETLINE_READAHEAD;
+    }
+#endif
+
+    if( dedup < 0 || static_cast<size_t>( dedup ) > FASTFILE_DEDUP_MAXCAPACITY ) {
+        PyErr_Format( PyExc_ValueError, "FastFile dedup must be from zero up to %zu lines", FASTFILE_DEDUP_MAXCAPACITY );
         return -1;
     }
 
-    FastFile* fast = new FastFile( filepath, rawregex );
+    // any of the fields() keywords splits the lines, by default on commas
+    bool isfields = delimiter != -1 || quote != Py_None || columns != Py_None || types != Py_None;
+    FastFileFieldOptions fieldoptions;
+
+    if( isfields && !PyFastFile_fieldoptions( delimiter == -1 ? ',' : delimiter, quote, columns, types, mode, fieldoptions ) ) {
+        return -1;
+    }
+
+    if( enginename && engine != FASTFILE_REGEX_DISABLED && backend == FASTFILE_GETLINE_DISABLED ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile builtins backend does not support a regex engine" );
+        return -1;
+    }
+
+    if( ( lineindex || indexfile ) && backend == FASTFILE_GETLINE_DISABLED ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile builtins backend does not support a line index" );
+        return -1;
+    }
+
+    if( follow && backend == FASTFILE_GETLINE_DISABLED ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile builtins backend does not support follow" );
+        return -1;
+    }
+
+    // a followed file truncated while its lines are still used from the mapping would raise SIGBUS
+    if( follow && backend == FASTFILE_GETLINE_MEMORYMAP ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile mmap backend does not support follow" );
+        return -1;
+    }
+
+    // the regex can be a single pattern or a list of patterns
+    std::vector<std::string> patterns;
+
+    if( rawregex == NULL ) {
+        patterns.push_back( "" );
+    }
+    else if( PyUnicode_Check( rawregex ) ) {
+        const char* pattern = PyUnicode_AsUTF8( rawregex );
+
+        if( pattern == NULL ) {
+            return -1;
+        }
+        patterns.push_back( pattern );
+    }
+    else if( PyList_Check( rawregex ) || PyTuple_Check( rawregex ) ) {
+        for( Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE( rawregex ); ++index ) {
+            PyObject* item = PySequence_Fast_GET_ITEM( rawregex, index );
+            const char* pattern = PyUnicode_Check( item ) ? PyUnicode_AsUTF8( item ) : NULL;
+
+            if( pattern == NULL ) {
+                if( !PyErr_Occurred() ) {
+                    PyErr_SetString( PyExc_TypeError, "FastFile regex patterns must be strings" );
+                }
+                return -1;
+            }
+            patterns.push_back( pattern );
+        }
+
+        if( patterns.empty() ) {
+            patterns.push_back( "" );
+        }
+    }
+    else {
+        PyErr_SetString( PyExc_TypeError, "FastFile regex must be a string or a list of strings" );
+        return -1;
+    }
+
+    FastFileLineOptions lineoptions;
+    lineoptions.mode = mode;
+    lineoptions.dedup = dedup;
+    lineoptions.lineindex = lineindex;
+    lineoptions.indexfile = indexfile ? indexfile : "";
+    lineoptions.follow = follow;
+
+    // a control character delimiter, as the tab character, must be kept while the lines are trimmed
+    if( isfields ) {
+        lineoptions.keptcharacter = fastfile_keptcharacter( FASTFILE_TRIMUFT8, fieldoptions.delimiter );
+    }
+
+    // calling __init__() again replaces the object opened by the previous call, closing its file
+    delete self->cppobjectpointer;
+    FastFile* fast = fastfile_create( filepath, patterns, backend, engine, lineoptions );
     self->cppobjectpointer = fast;
+
+    Py_INCREF( args );
+    Py_XINCREF( kwargs );
+    Py_XSETREF( self->args, args );
+    Py_XSETREF( self->kwargs, kwargs );
+
+    if( isfields && !fast->fields( fieldoptions ) ) {
+        return -1;
+    }
     return 0;
 }
 
 // destruct the object
 static void PyFastFile_dealloc(PyFastFile* self)
 {
+    // the builtins backend calls Python to close its file, which must not see the exception being
+    // raised while this object is released, e.g., by tail()
+    PyObject* errortype;
+    PyObject* errorvalue;
+    PyObject* errortraceback;
+    PyErr_Fetch( &errortype, &errorvalue, &errortraceback );
+
     // https://stackoverflow.com/questions/56212363/should-i-call-delete-or-py-xdecref-for-a-c-class-on-custom-dealloc-for-python
     delete self->cppobjectpointer;
+    Py_XDECREF( self->args );
+    Py_XDECREF( self->kwargs );
     Py_TYPE(self)->tp_free( (PyObject*) self );
+
+    PyErr_Restore( errortype, errorvalue, errortraceback );
 }
 
 static PyObject* PyFastFile_tp_call(PyFastFile* self, PyObject* args, PyObject *kwargs)
 {
     PyObject* returnvalue = (self->cppobjectpointer)->call();
-    Py_INCREF( returnvalue );
+    Py_XINCREF( returnvalue );
     return returnvalue;
 }
 
@@ -78,7 +348,7 @@ static PyObject* PyFastFile_iternext(PyFastFile* self, PyObject* args)
     }
 
     PyObject* returnvalue = (self->cppobjectpointer)->call();
-    Py_INCREF( returnvalue );
+    Py_XINCREF( returnvalue );
     return returnvalue;
 }
 
@@ -95,6 +365,151 @@ static PyObject* PyFastFile_getlines(PyFastFile* self, PyObject* args)
     return PyUnicode_DecodeUTF8( returnvalue.c_str(), returnvalue.size(), "replace" );
 }
 
+static PyObject* PyFastFile_readlines(PyFastFile* self, PyObject* args)
+{
+    Py_ssize_t linestoread = -1;
+
+    if( !PyArg_ParseTuple( args, "|n", &linestoread ) ) {
+        return NULL;
+    }
+    return (self->cppobjectpointer)->readlines( linestoread, 0 );
+}
+
+// Returns a tuple with one column for each of the fields() columns, with the next `nth` lines
+static PyObject* PyFastFile_readcolumns(PyFastFile* self, PyObject* args)
+{
+    Py_ssize_t linestoread = -1;
+
+    if( !PyArg_ParseTuple( args, "|n", &linestoread ) ) {
+        return NULL;
+    }
+
+    if( self->cppobjectpointer->linecache.fieldoptions.columns.empty() || !self->cppobjectpointer->linecache.isfields ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile readcolumns requires the fields columns or types" );
+        return NULL;
+    }
+    return (self->cppobjectpointer)->readcolumns( linestoread );
+}
+
+static PyObject* PyFastFile_readchunk(PyFastFile* self, PyObject* args)
+{
+    Py_ssize_t charstoread;
+
+    if( !PyArg_ParseTuple( args, "n", &charstoread ) ) {
+        return NULL;
+    }
+    return (self->cppobjectpointer)->readlines( -1, charstoread );
+}
+
+static PyObject* PyFastFile_patternids(PyFastFile* self, PyObject* args)
+{
+    return (self->cppobjectpointer)->patternids();
+}
+
+static PyObject* PyFastFile_stats(PyFastFile* self, PyObject* args)
+{
+    return (self->cppobjectpointer)->stats();
+}
+
+static PyObject* PyFastFile_seekline(PyFastFile* self, PyObject* args)
+{
+    Py_ssize_t line;
+
+    if( !PyArg_ParseTuple( args, "n", &line ) ) {
+        return NULL;
+    }
+    return (self->cppobjectpointer)->seekline( line );
+}
+
+// Returns a new FastFile object with the same constructor arguments, iterating from the file last
+// line to its first line
+static PyObject* PyFastFile_reversed(PyFastFile* self, PyObject* args)
+{
+    PyObject* reversed = PyObject_Call( (PyObject*) Py_TYPE( self ), self->args, self->kwargs );
+
+    if( reversed == NULL ) {
+        return NULL;
+    }
+
+    if( !( (PyFastFile*) reversed )->cppobjectpointer->reverse() ) {
+        Py_DECREF( reversed );
+        PyErr_SetString( PyExc_ValueError, "FastFile builtins backend and compressed files do not support reversed lines" );
+        return NULL;
+    }
+
+    // fields() was called after the constructor, then, it is not on the constructor arguments
+    if( self->cppobjectpointer->linecache.isfields
+            && !( (PyFastFile*) reversed )->cppobjectpointer->fields( self->cppobjectpointer->linecache.fieldoptions ) )
+    {
+        Py_DECREF( reversed );
+        return NULL;
+    }
+    return reversed;
+}
+
+// Makes the next lines tuples with their fields split by `delimiter`, or only with the fields on
+// `columns`, ignoring the delimiters between two `quote` characters. It returns the same object,
+// i.e., `for fields in FastFile( "file.csv" ).fields( ",", quote='"' )`.
+static PyObject* PyFastFile_fields(PyFastFile* self, PyObject* args, PyObject* kwargs)
+{
+    int delimiter;
+    PyObject* quote = Py_None;
+    PyObject* columns = Py_None;
+    PyObject* types = Py_None;
+    FastFileFieldOptions fieldoptions;
+
+    static char* kwlist[] = {
+        const_cast<char*>( "delimiter" ),
+        const_cast<char*>( "quote" ),
+        const_cast<char*>( "columns" ),
+        const_cast<char*>( "types" ),
+        NULL
+    };
+
+    if( !PyArg_ParseTupleAndKeywords( args, kwargs, "C|OOO", kwlist, &delimiter, &quote, &columns, &types ) ) {
+        return NULL;
+    }
+
+    if( !PyFastFile_fieldoptions( delimiter, quote, columns, types, self->cppobjectpointer->linecache.mode, fieldoptions )
+            || !self->cppobjectpointer->fields( fieldoptions ) )
+    {
+        return NULL;
+    }
+
+    Py_INCREF( self );
+    return (PyObject*) self;
+}
+
+// Returns a list with the last `nth` lines, in the file order
+static PyObject* PyFastFile_tail(PyFastFile* self, PyObject* args)
+{
+    Py_ssize_t linestoread;
+
+    if( !PyArg_ParseTuple( args, "n", &linestoread ) ) {
+        return NULL;
+    }
+
+    if( linestoread < 0 ) {
+        PyErr_SetString( PyExc_ValueError, "FastFile tail must be zero or a positive number of lines" );
+        return NULL;
+    }
+
+    PyObject* reversed = PyFastFile_reversed( self, NULL );
+
+    if( reversed == NULL ) {
+        return NULL;
+    }
+
+    PyObject* lines = ( (PyFastFile*) reversed )->cppobjectpointer->readlines( linestoread, 0 );
+    Py_DECREF( reversed );
+
+    if( lines != NULL && PyList_Reverse( lines ) ) {
+        Py_DECREF( lines );
+        return NULL;
+    }
+    return lines;
+}
+
 static PyObject* PyFastFile_resetlines(PyFastFile* self, PyObject* args)
 {
     (self->cppobjectpointer)->resetlines();
@@ -116,6 +531,15 @@ static PyMethodDef PyFastFile_methods[] =
     { "resetlines", (PyCFunction) PyFastFile_resetlines, METH_NOARGS, "Reset the current line counter" },
     { "line", (PyCFunction) PyFastFile_tp_call, METH_NOARGS, "Return the next line or an empty string on the file end" },
     { "next", (PyCFunction) PyFastFile_iternext, METH_NOARGS, "Advances the iterator to the next line" },
+    { "readlines", (PyCFunction) PyFastFile_readlines, METH_VARARGS, "Return a list with the next `nth` lines, or all the remaining lines" },
+    { "readcolumns", (PyCFunction) PyFastFile_readcolumns, METH_VARARGS, "Return a tuple with the fields columns of the next `nth` lines, or of all the remaining lines" },
+    { "readchunk", (PyCFunction) PyFastFile_readchunk, METH_VARARGS, "Return a list with the next lines, up to about `nth` characters" },
+    { "patternids", (PyCFunction) PyFastFile_patternids, METH_NOARGS, "Return a list with the indexes of the regex patterns matching the current line" },
+    { "seekline", (PyCFunction) PyFastFile_seekline, METH_VARARGS, "Move the iterator to the `nth` file line, counting from zero" },
+    { "tail", (PyCFunction) PyFastFile_tail, METH_VARARGS, "Return a list with the last `nth` lines, reading the file backwards" },
+    { "__reversed__", (PyCFunction) PyFastFile_reversed, METH_NOARGS, "Return a new FastFile iterating from the file last line to its first line" },
+    { "fields", (PyCFunction) PyFastFile_fields, METH_VARARGS | METH_KEYWORDS, "Return this object, now iterating over tuples with each line fields, or with its `columns` as `types`" },
+    { "stats", (PyCFunction) PyFastFile_stats, METH_NOARGS, "Return a dictionary with the line cache arena high-water marks" },
     { NULL, NULL, 0, NULL }  /* Sentinel */
 };
 
@@ -125,6 +549,28 @@ static PyTypeObject PyFastFileType =
     "fastfilepackage.FastFile" /* tp_name */
 };
 
+// Returns a tuple with the names of the options compiled into the module
+static PyObject* PyFastFile_optionnames(const FastFileOption* options)
+{
+    Py_ssize_t count = 0;
+    while( options[count].name != NULL ) {
+        ++count;
+    }
+
+    PyObject* names = PyTuple_New( count );
+
+    for( Py_ssize_t index = 0; names != NULL && index < count; ++index ) {
+        PyObject* name = PyUnicode_FromString( options[index].name );
+
+        if( name == NULL ) {
+            Py_DECREF( names );
+            return NULL;
+        }
+        PyTuple_SET_ITEM( names, index, name );
+    }
+    return names;
+}
+
 // create the module
 PyMODINIT_FUNC PyInit_fastfilepackage(void)
 {
@@ -145,7 +591,9 @@ PyMODINIT_FUNC PyInit_fastfilepackage(void)
     // PyFastFileType.tp_members = PyFastFile_members;
     PyFastFileType.tp_init = (initproc) PyFastFile_init;
 
-    if( PyType_Ready( &PyFastFileType) < 0 ) {
+    if( PyType_Ready( &PyFastFileType) < 0 || PyType_Ready( fastfile_viewtype() ) < 0
+            || PyType_Ready( fastfile_columntype() ) < 0 || PyType_Ready( fastfile_columnviewtype() ) < 0 )
+    {
         return NULL;
     }
 
@@ -159,6 +607,10 @@ PyMODINIT_FUNC PyInit_fastfilepackage(void)
     // https://stackoverflow.com/questions/3001239/define-a-global-in-a-python-module-from-a-c-api
     PyObject_SetAttrString( thismodule, "__version__", Py_BuildValue( "s", __version__ ) );
     PyObject_SetAttrString( thismodule, "FASTFILE_TRIMUFT8", Py_BuildValue( "i", FASTFILE_TRIMUFT8_CONSTANT ) );
+    PyObject_SetAttrString( thismodule, "BACKENDS", PyFastFile_optionnames( fastfile_backends ) );
+    PyObject_SetAttrString( thismodule, "ENGINES", PyFastFile_optionnames( fastfile_engines ) );
+    PyObject_SetAttrString( thismodule, "MODES", PyFastFile_optionnames( fastfile_modes ) );
+    PyObject_SetAttrString( thismodule, "TYPES", PyFastFile_optionnames( fastfile_types ) );
 
     // Add FastFile class to thismodule allowing the use to create objects
     Py_INCREF( &PyFastFileType );
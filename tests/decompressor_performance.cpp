@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../source/fastfiledecompressor.h"
+
+// Returns how many bytes were read from the file, or decompressed from it when `compression` is set
+size_t benchmark(const char* filepath, int compression) {
+    int filedescriptor = open( filepath, O_RDONLY );
+
+    if( filedescriptor == -1 ) {
+        std::cerr << "Could not open the file '" << filepath << "'!" << std::endl;
+        return 0;
+    }
+
+    FastFileDecompressor decompressor;
+    if( compression != FASTFILE_COMPRESSION_NONE && !decompressor.start( filedescriptor, compression ) ) {
+        close( filedescriptor );
+        return 0;
+    }
+
+    std::vector<char> buffer( 1048576 );
+    size_t totalsize = 0;
+    ssize_t bytesread;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    while( ( bytesread = compression ? decompressor.read( buffer.data(), buffer.size() )
+            : read( filedescriptor, buffer.data(), buffer.size() ) ) > 0 )
+    {
+        totalsize += bytesread;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << fastfile_compressionname( compression ) << " threads " << decompressor.threads
+            << " bytes " << totalsize << " time " << elapsed.count() << " seconds "
+            << totalsize / elapsed.count() / 1e9 << " GB/s" << ( bytesread < 0 ? " FAILED" : "" ) << std::endl;
+
+    decompressor.stop();
+    close( filedescriptor );
+    return totalsize;
+}
+
+// Compares reading a plain file with decompressing the same file, e.g., compressed with `gzip -k`,
+// `zstd -k`, `lz4 -k` or `bgzip -k`, with the libraries found on the system:
+// g++ -o main.exe decompressor_performance.cpp -O2 --std=c++11 -pthread -DFASTFILE_WITH_ZLIB -DFASTFILE_WITH_ZSTD
+//     -DFASTFILE_WITH_LZ4 -lz -lzstd -llz4 && ./main.exe ./myfile.log ./myfile.log.gz ./myfile.log.zst
+int main(int argc, char const *argv[])
+{
+    const char* filepath = argc > 1 ? argv[1] : "./myfile.log";
+
+    // the first run only loads the file into the page cache
+    benchmark( filepath, FASTFILE_COMPRESSION_NONE );
+    size_t expected = benchmark( filepath, FASTFILE_COMPRESSION_NONE );
+
+    for( int index = 2; index < argc; ++index ) {
+        int compression = fastfile_compression( argv[index] );
+
+        if( !fastfile_hasdecompressor( compression ) ) {
+            std::cout << "The file '" << argv[index] << "' is not compressed with some available library!" << std::endl;
+            continue;
+        }
+
+        if( benchmark( argv[index], compression ) != expected ) {
+            std::cout << "The file '" << argv[index] << "' has a different decompressed size!" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,5 +1,8 @@
 import io
+import os
+import sys
 import time
+import subprocess
 import datetime
 import fastfilepackage
 
@@ -30,3 +33,31 @@ print( 'FastFile timedifference', timedifference, flush=True )
 print( 'fastfile_time %.2f%%, python_time %.2f%% = %.2f%%' % (
         fastfile_time/python_time, python_time/fastfile_time,
         abs( 1 - python_time/fastfile_time ) ), flush=True )
+
+
+# The same lines read by a build of another commit, e.g., the commit before the compact ASCII
+# strings, which decoded each line with PyUnicode_DecodeUTF8(), built with:
+#   git worktree add ../fastfilebaseline <commit>
+#   cd ../fastfilebaseline && python3 setup.py build_ext --inplace
+# and `FASTFILE_BASELINE=../fastfilebaseline python3 fastfileperformance.py`. It runs on another
+# process, as both builds are the same `fastfilepackage` module.
+baselinepath = os.environ.get( 'FASTFILE_BASELINE' )
+
+if baselinepath:
+    baselinecode = (
+            'import time\n'
+            'import fastfilepackage\n'
+            'timenow = time.time()\n'
+            'for item in fastfilepackage.FastFile( %r ):\n'
+            '    pass\n'
+            'print( time.time() - timenow )\n' ) % os.path.abspath( testfile )
+
+    baselinepath = os.path.abspath( baselinepath )
+    baselineprocess = subprocess.run( [ sys.executable, '-c', baselinecode ], cwd=baselinepath,
+            env=dict( os.environ, PYTHONPATH=baselinepath ), stdout=subprocess.PIPE, check=True )
+
+    baseline_time = float( baselineprocess.stdout )
+    timedifference = datetime.timedelta( seconds=baseline_time )
+    print( 'Baseline timedifference', timedifference, flush=True )
+    print( 'fastfile_time %.2f%%, baseline_time %.2f%%' % (
+            fastfile_time/baseline_time, baseline_time/fastfile_time ), flush=True )
@@ -8,3 +8,155 @@ for item in iterable:
     iterable.resetlines()
     print( 'd) %s' % iterable() )
 
+
+iterable = fastfilepackage.FastFile( './sample.txt' )
+print( 'e) %s' % iterable.readlines( 2 ) )
+print( 'f) %s' % iterable.readchunk( 1024 ) )
+
+
+# requires FASTFILE_REGEX to filter the lines
+iterable = fastfilepackage.FastFile( './sample.txt', [ '1', '[23]', '3' ], backend='posix' )
+for item in iterable:
+    print( 'g) %s %s' % ( item, iterable.patternids() ) )
+
+
+for backend in fastfilepackage.BACKENDS:
+    iterable = fastfilepackage.FastFile( './sample.txt', backend=backend )
+    print( 'h) %s %s' % ( backend, iterable.readlines() ) )
+
+
+iterable = fastfilepackage.FastFile( './sample.txt', backend='posix' )
+print( 'i) %s %s' % ( iterable.readlines(), iterable.stats() ) )
+
+
+for mode in fastfilepackage.MODES:
+    iterable = fastfilepackage.FastFile( './sample.txt', backend='posix', mode=mode )
+    print( 'j) %s %s' % ( mode, [ bytes( line ) if mode == 'view' else line for line in iterable ] ) )
+
+
+iterable = fastfilepackage.FastFile( './sample.txt', backend='posix', dedup=2 )
+print( 'k) %s %s' % ( iterable.readlines(), iterable.stats() ) )
+
+
+iterable = fastfilepackage.FastFile( './sample.txt', backend='posix', lineindex=True )
+iterable.seekline( 1 )
+print( 'l) %s' % iterable.readlines() )
+
+
+iterable = fastfilepackage.FastFile( './sample.txt', backend='posix' )
+print( 'm) %s %s' % ( iterable.tail( 2 ), list( reversed( iterable ) ) ) )
+
+
+import threading
+iterable = fastfilepackage.FastFile( './sample.txt', backend='posix', follow=True )
+threading.Timer( 1, iterable.close ).start()
+
+# the last line without a new line character is still waiting for it when the file is closed
+print( 'n) %s' % [ line for line in iterable ] )
+
+
+import os
+import gzip
+with open( './sample.txt', 'rb' ) as plainfile, gzip.open( './sample.txt.gz', 'wb' ) as compressedfile:
+    compressedfile.write( plainfile.read() )
+
+iterable = fastfilepackage.FastFile( './sample.txt.gz' )
+print( 'o) %s' % iterable.readlines() )
+os.remove( './sample.txt.gz' )
+
+
+iterable = fastfilepackage.FastFile( './sample.txt', backend='uring' )
+print( 'p) %s' % iterable.readlines() )
+
+
+with open( './sample.csv', 'w' ) as csvfile:
+    csvfile.write( 'id,name,city\n1,"Doe, John",Paris\n2,"Roe, ""Jane""",Rome' )
+
+iterable = fastfilepackage.FastFile( './sample.csv', backend='posix' ).fields( ',', quote='"' )
+print( 'q) %s %s' % ( iterable.readlines(),
+        list( fastfilepackage.FastFile( './sample.csv', backend='posix' ).fields( ',', quote='"', columns=[2, 0] ) ) ) )
+
+
+# the header line is read before its fields are parsed as numbers
+iterable = fastfilepackage.FastFile( './sample.csv', backend='posix' )
+header = next( iterable )
+iterable.fields( ',', quote='"', columns=[0, 1], types=['int', 'str'] )
+print( 'r) %s %s %s' % ( fastfilepackage.TYPES, header, iterable.readlines() ) )
+
+
+iterable = fastfilepackage.FastFile( './sample.csv', backend='posix' )
+header = next( iterable )
+iterable.fields( ',', quote='"', columns=[0, 1], types=['int', 'str'] )
+identifiers, names = iterable.readcolumns()
+print( 's) %s %s %s %s' % ( memoryview( identifiers ).tolist(), bytes( names ), names.offsets.tolist(), names.validity ) )
+os.remove( './sample.csv' )
+
+
+# with FASTFILE_REGEXBUFFER, a match starting on the previous line new line must not hide this one
+# also scanning the lines right where the mmap and the read ahead backends read them
+for engine in fastfilepackage.ENGINES[1:]:
+    for backend in [ 'posix', 'mmap', 'readahead' ]:
+        iterable = fastfilepackage.FastFile( './sample.txt', '[^x]*3', backend=backend, engine=engine )
+        print( 't) %s %s %s' % ( engine, backend, iterable.readlines() ) )
+
+
+with open( './rotated.log', 'w' ) as logfile:
+    logfile.write( 'a\n' )
+
+iterable = fastfilepackage.FastFile( './rotated.log', backend='posix', follow=True )
+firstline = next( iterable )
+
+# the line written just before the log rotates is read before the lines of the new file
+with open( './rotated.log', 'a' ) as logfile:
+    logfile.write( 'x\n' )
+os.rename( './rotated.log', './rotated.log.1' )
+with open( './rotated.log', 'w' ) as logfile:
+    logfile.write( 'y\n' )
+
+threading.Timer( 1, iterable.close ).start()
+print( 'u) %s %s' % ( firstline, [ line for line in iterable ] ) )
+os.remove( './rotated.log' )
+os.remove( './rotated.log.1' )
+
+try:
+    fastfilepackage.FastFile( './sample.txt', backend='mmap', follow=True )
+except ValueError as error:
+    print( 'u) %s' % error )
+
+
+# the empty line is a row too, then, the rows are the same lines iterating over the fields
+with open( './empty.csv', 'w' ) as csvfile:
+    csvfile.write( '1,a\n\n3,c\n' )
+
+identifiers, names = fastfilepackage.FastFile( './empty.csv', backend='posix', types=['int', 'str'] ).readcolumns()
+print( 'v) %s %s %s %s' % ( list( fastfilepackage.FastFile( './empty.csv', backend='posix', types=['int', 'str'] ) ),
+        memoryview( identifiers ).tolist(), identifiers.nullcount, names.nullcount ) )
+os.remove( './empty.csv' )
+
+
+# the tab delimiter is kept by the UTF-8 trimming, while the other control characters are removed
+with open( './sample.tsv', 'w' ) as tsvfile:
+    tsvfile.write( 'id\tname\n1\tDo\x01e\n' )
+
+print( 'w) %s %s' % ( list( fastfilepackage.FastFile( './sample.tsv', backend='readahead', delimiter='\t' ) ),
+        list( fastfilepackage.FastFile( './sample.tsv', backend='posix' ).fields( '\t' ) ) ) )
+os.remove( './sample.tsv' )
+
+
+# the file rewritten with the same size on the same second does not load its stale index
+with open( './indexed.txt', 'w' ) as indexedfile:
+    indexedfile.write( 'a\n' * 2048 )
+fastfilepackage.FastFile( './indexed.txt', backend='posix', indexfile='./indexed.txt.index' ).seekline( 1024 )
+
+with open( './indexed.txt', 'w' ) as indexedfile:
+    indexedfile.write( 'b' * 2047 + '\n' + 'c\n' * 1024 )
+iterable = fastfilepackage.FastFile( './indexed.txt', backend='posix', indexfile='./indexed.txt.index' )
+iterable.seekline( 1024 )
+print( 'x) %s' % iterable.readlines() )
+os.remove( './indexed.txt' )
+os.remove( './indexed.txt.index' )
+
+
+# the procfs files report no size, then, they are read with read() instead of io_uring
+print( 'y) %s' % ( len( fastfilepackage.FastFile( '/proc/self/status', backend='uring' ).readlines() ) > 1 ) )
+print( 'z) %s' % ( len( fastfilepackage.FastFile( '/proc/self/status', backend='mmap' ).readlines() ) > 1 ) )
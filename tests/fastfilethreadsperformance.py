@@ -0,0 +1,42 @@
+import sys
+import time
+import datetime
+import threading
+import fastfilepackage
+
+# usually a file with 100MB, it is read once by each thread
+testfile = './myfile.log'
+threadcount = int( sys.argv[1] ) if len( sys.argv ) > 1 else 4
+regex = sys.argv[2] if len( sys.argv ) > 2 else ''
+
+def readfile():
+    iterable = fastfilepackage.FastFile( testfile, regex )
+    for item in iterable:
+        if None:
+            var = item
+
+# the first run only loads the file into the page cache
+readfile()
+
+timenow = time.time()
+for index in range( threadcount ):
+    readfile()
+
+sequential_time = time.time() - timenow
+timedifference = datetime.timedelta( seconds=sequential_time )
+print( 'Sequential timedifference', timedifference, flush=True )
+
+timenow = time.time()
+threads = [ threading.Thread( target=readfile ) for index in range( threadcount ) ]
+for thread in threads:
+    thread.start()
+
+for thread in threads:
+    thread.join()
+
+threads_time = time.time() - timenow
+timedifference = datetime.timedelta( seconds=threads_time )
+print( 'Threads    timedifference', timedifference, flush=True )
+print( 'threads %d, threads_time %.2f%%, sequential_time %.2f%% = %.2fx speedup' % (
+        threadcount, threads_time/sequential_time, sequential_time/threads_time,
+        sequential_time/threads_time ), flush=True )
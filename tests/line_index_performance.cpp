@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <iostream>
+
+#include "../source/fastfilelineindex.h"
+
+// Writes a file with about 1GB of short log lines if it does not exist yet
+void createtestfile(const char* filepath) {
+    FILE* cfilestream = fopen( filepath, "r" );
+
+    if( cfilestream != NULL ) {
+        fclose( cfilestream );
+        return;
+    }
+
+    std::cerr << "Creating the test file '" << filepath << "'..." << std::endl;
+    cfilestream = fopen( filepath, "w" );
+
+    for( long long int index = 0; index < 18000000; ++index ) {
+        fprintf( cfilestream, "2019-05-%02lld INFO worker %lld processed request id=%lld\n",
+                index % 30, index % 17, index );
+    }
+    fclose( cfilestream );
+}
+
+// Returns the index offsets, and prints how fast they were built
+std::vector<uint64_t> benchmark(const char* filepath, unsigned int threads, bool usemapping) {
+    FastFileLineIndex lineindex;
+    lineindex.setup( filepath, "" );
+    lineindex.threads = threads;
+    lineindex.usemapping = usemapping;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool isbuilt = lineindex.wait();
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << ( usemapping ? "mmap  " : "pread " ) << "threads " << threads
+            << " lines " << lineindex.lines << " time " << elapsed.count() << " seconds "
+            << lineindex.filesize / elapsed.count() / 1e9 << " GB/s" << ( isbuilt ? "" : " FAILED" ) << std::endl;
+    return lineindex.offsets;
+}
+
+// g++ -o main.exe line_index_performance.cpp -O2 --std=c++11 -pthread && ./main.exe ./myfile.log 8
+int main(int argc, char const *argv[])
+{
+    const char* filepath = argc > 1 ? argv[1] : "./myfile.log";
+    unsigned int maximumthreads = argc > 2 ? atoi( argv[2] ) : std::max( std::thread::hardware_concurrency(), 1u );
+    createtestfile( filepath );
+
+    // the first run only loads the file into the page cache, and its offsets are the reference
+    std::vector<uint64_t> expected = benchmark( filepath, 1, false );
+
+    for( unsigned int threads = 1; threads <= maximumthreads; threads *= 2 ) {
+        for( bool usemapping : { false, true } ) {
+            if( benchmark( filepath, threads, usemapping ) != expected ) {
+                std::cout << "The index built with " << threads << " threads has different offsets!" << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../source/fastfilesimd.h"
+
+const size_t READBUFFERSIZE = 1048576;
+
+// Writes a file with about 1GB of short log lines if it does not exist yet
+void createtestfile(const char* filepath) {
+    FILE* cfilestream = fopen( filepath, "r" );
+
+    if( cfilestream != NULL ) {
+        fclose( cfilestream );
+        return;
+    }
+
+    std::cerr << "Creating the test file '" << filepath << "'..." << std::endl;
+    cfilestream = fopen( filepath, "w" );
+
+    for( long long int index = 0; index < 18000000; ++index ) {
+        fprintf( cfilestream, "2019-05-%02lld INFO worker %lld processed request id=%lld\n",
+                index % 30, index % 17, index );
+    }
+    fclose( cfilestream );
+}
+
+long long int countwithgetline(const char* filepath) {
+    size_t linebuffersize = 131072;
+    char* readline = (char*) malloc( linebuffersize );
+    FILE* cfilestream = fopen( filepath, "r" );
+    long long int linecount = 0;
+
+    while( getline( &readline, &linebuffersize, cfilestream ) != -1 ) {
+        ++linecount;
+    }
+
+    fclose( cfilestream );
+    free( readline );
+    return linecount;
+}
+
+long long int countwithmemchr(const char* filepath) {
+    char* readbuffer = (char*) malloc( READBUFFERSIZE );
+    int filedescriptor = open( filepath, O_RDONLY );
+    long long int linecount = 0;
+    ssize_t bytesread;
+
+    while( ( bytesread = read( filedescriptor, readbuffer, READBUFFERSIZE ) ) > 0 ) {
+        const char* cursor = readbuffer;
+        const char* bufferend = readbuffer + bytesread;
+
+        while( ( cursor = static_cast<const char*>( memchr( cursor, '\n', bufferend - cursor ) ) ) != NULL ) {
+            ++linecount;
+            ++cursor;
+        }
+    }
+
+    close( filedescriptor );
+    free( readbuffer );
+    return linecount;
+}
+
+long long int countwithscanner(const char* filepath, fastfile_blockmask_function charmask) {
+    char* readbuffer = (char*) malloc( READBUFFERSIZE );
+    int filedescriptor = open( filepath, O_RDONLY );
+    long long int linecount = 0;
+    ssize_t bytesread;
+
+    FastFileScanner newlinescanner;
+    newlinescanner.charmask = charmask;
+
+    while( ( bytesread = read( filedescriptor, readbuffer, READBUFFERSIZE ) ) > 0 ) {
+        newlinescanner.reset( readbuffer, bytesread );
+
+        while( newlinescanner.next() != NULL ) {
+            ++linecount;
+        }
+    }
+
+    close( filedescriptor );
+    free( readbuffer );
+    return linecount;
+}
+
+template<typename Function>
+void benchmark(const char* name, Function function) {
+    auto start = std::chrono::high_resolution_clock::now();
+    long long int linecount = function();
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << name << " lines " << linecount << " time " << elapsed.count() << " seconds" << std::endl;
+}
+
+// g++ -o main.exe newline_scanner_performance.cpp -O2 --std=c++11 && ./main.exe ./myfile.log
+int main(int argc, char const *argv[])
+{
+    const char* filepath = argc > 1 ? argv[1] : "./myfile.log";
+    createtestfile( filepath );
+
+    // the first run only loads the file into the page cache
+    countwithmemchr( filepath );
+
+    benchmark( "getline      ", [&]() { return countwithgetline( filepath ); } );
+    benchmark( "memchr       ", [&]() { return countwithmemchr( filepath ); } );
+    benchmark( "scanner      ", [&]() { return countwithscanner( filepath, fastfile_charmask64_select() ); } );
+    benchmark( "scanner/c    ", [&]() { return countwithscanner( filepath, fastfile_charmask64_scalar ); } );
+
+#if defined(FASTFILE_SIMD_SSE2)
+    benchmark( "scanner/sse2 ", [&]() { return countwithscanner( filepath, fastfile_charmask64_sse2 ); } );
+#endif
+
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        benchmark( "scanner/avx2 ", [&]() { return countwithscanner( filepath, fastfile_charmask64_avx2 ); } );
+    }
+#endif
+}
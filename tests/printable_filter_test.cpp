@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <string>
+#include <random>
+#include <vector>
+#include <iostream>
+
+#include "../source/fastfilesimd.h"
+
+// Runs the vectorized fastfile_printableonly() implementations against the scalar reference
+// implementation with random buffers of several sizes, alignments and densities of characters
+// which are not printable, both in place and into another buffer.
+int testimplementation(const char* name, fastfile_printableonly_function printableonly) {
+    std::mt19937 randomgenerator( 42 );
+    int failures = 0;
+
+    for( unsigned int size = 0; size < 300; ++size ) {
+        for( unsigned int density = 0; density <= 100; density += 10 ) {
+            for( unsigned int alignment = 0; alignment < 8; ++alignment ) {
+                std::vector<char> source( size + alignment + 64 );
+                std::uniform_int_distribution<int> percentage( 0, 99 );
+                std::uniform_int_distribution<int> printable( 32, 127 );
+                std::uniform_int_distribution<int> anybyte( 0, 255 );
+
+                for( unsigned int index = 0; index < size; ++index ) {
+                    source[alignment + index] = static_cast<char>(
+                            static_cast<unsigned int>( percentage( randomgenerator ) ) < density
+                                ? anybyte( randomgenerator ) : printable( randomgenerator ) );
+                }
+
+                std::vector<char> expected( size + 64 );
+                size_t expectedsize = fastfile_printableonly_scalar(
+                        expected.data(), source.data() + alignment, size );
+
+                std::vector<char> destination( size );
+                size_t destinationsize = printableonly( destination.data(), source.data() + alignment, size );
+
+                std::vector<char> inplace( source );
+                size_t inplacesize = printableonly( inplace.data() + alignment, inplace.data() + alignment, size );
+
+                if( destinationsize != expectedsize || inplacesize != expectedsize
+                    || memcmp( destination.data(), expected.data(), expectedsize ) != 0
+                    || memcmp( inplace.data() + alignment, expected.data(), expectedsize ) != 0 )
+                {
+                    std::cerr << "FAILED " << name << " size " << size << " density " << density
+                            << " alignment " << alignment << " expectedsize " << expectedsize
+                            << " destinationsize " << destinationsize << " inplacesize " << inplacesize << std::endl;
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    std::cout << ( failures ? "FAILED " : "OK     " ) << name << std::endl;
+    return failures;
+}
+
+// g++ -o main.exe printable_filter_test.cpp -O2 --std=c++11 && ./main.exe
+int main(int argc, char const *argv[])
+{
+    int failures = 0;
+    failures += testimplementation( "selected", fastfile_printableonly_select() );
+
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "ssse3" ) ) {
+        failures += testimplementation( "ssse3", fastfile_printableonly_ssse3 );
+    }
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        failures += testimplementation( "avx2", fastfile_printableonly_avx2 );
+    }
+
+    #if defined(FASTFILE_SIMD_AVX512VBMI2)
+        if( __builtin_cpu_supports( "avx512vbmi2" ) && __builtin_cpu_supports( "avx512bw" ) ) {
+            failures += testimplementation( "avx512vbmi2", fastfile_printableonly_avx512vbmi2 );
+        }
+    #endif
+#endif
+
+    return failures ? 1 : 0;
+}
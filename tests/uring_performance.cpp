@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../source/fastfilereadahead.h"
+#include "../source/fastfileuring.h"
+
+#define GETLINE   0
+#define READAHEAD 1
+#define URING     2
+
+// Drops the file from the page cache, then, the next read really comes from the disk
+bool dropcache(int filedescriptor) {
+    return posix_fadvise( filedescriptor, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+}
+
+// Returns how many lines were read from the file with the FASTFILE_GETLINE=2 getline(), the read
+// ahead backend, or the read ahead backend with io_uring
+size_t benchmark(const char* filepath, int reader, bool iscold) {
+    int filedescriptor = open( filepath, O_RDONLY );
+
+    if( filedescriptor == -1 ) {
+        std::cerr << "Could not open the file '" << filepath << "'!" << std::endl;
+        return 0;
+    }
+
+    if( iscold && !dropcache( filedescriptor ) ) {
+        std::cerr << "Could not drop the file '" << filepath << "' from the page cache!" << std::endl;
+    }
+
+    size_t linecount = 0;
+    bool hasstarted = true;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if( reader == GETLINE ) {
+        FILE* cfile = fdopen( filedescriptor, "r" );
+        char* line = NULL;
+        size_t linesize = 0;
+
+        while( getline( &line, &linesize, cfile ) != -1 ) {
+            ++linecount;
+        }
+
+        free( line );
+        fclose( cfile );
+        filedescriptor = -1;
+    }
+    else {
+        FastFileUring uring;
+        FastFileReadAhead readahead;
+
+        if( reader == URING ) {
+            hasstarted = uring.start( filedescriptor );
+            readahead.source = &uring;
+        }
+
+        if( hasstarted && readahead.start( filedescriptor, FASTFILE_TRIMUFT8_DISABLED ) ) {
+            FastFileSpan span;
+
+            while( readahead.pop( span ) ) {
+                ++linecount;
+                readahead.release();
+            }
+        }
+
+        readahead.stop();
+        uring.stop();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    const char* readernames[] = { "getline", "readahead", "uring" };
+    std::cout << readernames[reader] << ( iscold ? " cold" : " warm" ) << " lines " << linecount
+            << " time " << elapsed.count() << " seconds" << ( hasstarted ? "" : " FAILED" ) << std::endl;
+
+    if( filedescriptor != -1 ) {
+        close( filedescriptor );
+    }
+    return linecount;
+}
+
+// Compares reading a file out of the page cache with getline(), which is what FASTFILE_GETLINE=2
+// uses, the read ahead backend with read(), and the read ahead backend with several io_uring reads
+// in flight. The page cache is dropped with posix_fadvise() before each cold run:
+// g++ -o main.exe uring_performance.cpp -O2 --std=c++11 -pthread && ./main.exe ./myfile.log
+int main(int argc, char const *argv[])
+{
+    const char* filepath = argc > 1 ? argv[1] : "./myfile.log";
+    size_t expected = benchmark( filepath, GETLINE, false );
+
+    for( int iscold = 1; iscold >= 0; --iscold ) {
+        for( int reader = GETLINE; reader <= URING; ++reader ) {
+            size_t linecount = benchmark( filepath, reader, iscold );
+
+            // the read ahead backend also counts the empty line after the last new line character
+            if( linecount != expected && linecount != expected + 1 ) {
+                std::cout << "The file '" << filepath << "' has a different line count!" << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <random>
+#include <vector>
+#include <iostream>
+
+#include "../source/fastfileutf8.h"
+
+// Returns random text with valid characters of 1 up to 4 bytes, and with `density` percent of
+// random bytes, which are control characters or invalid sequences most of the time
+std::vector<char> randomtext(std::mt19937& randomgenerator, size_t size, unsigned int density) {
+    static const char* characters[] = { "a", "Z", " ", "~", "\x7f", "\xc3\xa7", "\xc2\x80", "\xdf\xbf",
+            "\xe0\xa0\x80", "\xe6\x97\xa5", "\xed\x9f\xbf", "\xef\xbf\xbd", "\xf0\x90\x80\x80", "\xf0\x9f\x98\x80",
+            "\xf4\x8f\xbf\xbf" };
+
+    std::uniform_int_distribution<int> percentage( 0, 99 );
+    std::uniform_int_distribution<int> character( 0, sizeof(characters) / sizeof(characters[0]) - 1 );
+    std::uniform_int_distribution<int> anybyte( 0, 255 );
+    std::vector<char> text;
+
+    while( text.size() < size ) {
+        if( static_cast<unsigned int>( percentage( randomgenerator ) ) < density ) {
+            text.push_back( static_cast<char>( anybyte( randomgenerator ) ) );
+        }
+        else {
+            const char* picked = characters[character( randomgenerator )];
+            text.insert( text.end(), picked, picked + strlen( picked ) );
+        }
+    }
+    text.resize( size );
+    return text;
+}
+
+// Runs the vectorized fastfile_utf8only() and fastfile_utf8prefix() implementations against the
+// scalar reference implementations with random text of several sizes, alignments and densities of
+// invalid bytes, both in place and into another buffer.
+int testimplementation(const char* name, fastfile_utf8only_function utf8only, fastfile_utf8prefix_function utf8prefix) {
+    std::mt19937 randomgenerator( 42 );
+    int failures = 0;
+
+    for( unsigned int size = 0; size < 300; ++size ) {
+        for( unsigned int density = 0; density <= 100; density += 5 ) {
+            for( unsigned int alignment = 0; alignment < 4; ++alignment ) {
+                std::vector<char> text = randomtext( randomgenerator, size, density );
+                std::vector<char> source( alignment + size + 64 );
+                std::copy( text.begin(), text.end(), source.begin() + alignment );
+
+                std::vector<char> expected( size + 64 );
+                size_t expectedsize = fastfile_utf8only_scalar( expected.data(), source.data() + alignment, size );
+                size_t expectedprefix = fastfile_utf8prefix_scalar( source.data() + alignment, size );
+
+                std::vector<char> destination( size + 64 );
+                size_t destinationsize = utf8only( destination.data(), source.data() + alignment, size );
+                size_t prefix = utf8prefix( source.data() + alignment, size );
+
+                std::vector<char> inplace( source );
+                size_t inplacesize = utf8only( inplace.data() + alignment, inplace.data() + alignment, size );
+
+                if( destinationsize != expectedsize || inplacesize != expectedsize || prefix != expectedprefix
+                    || memcmp( destination.data(), expected.data(), expectedsize ) != 0
+                    || memcmp( inplace.data() + alignment, expected.data(), expectedsize ) != 0 )
+                {
+                    std::cerr << "FAILED " << name << " size " << size << " density " << density
+                            << " alignment " << alignment << " expectedsize " << expectedsize
+                            << " destinationsize " << destinationsize << " inplacesize " << inplacesize
+                            << " expectedprefix " << expectedprefix << " prefix " << prefix << std::endl;
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    // all sequences of 3 bytes starting with a non ASCII byte, with some interesting last bytes, after
+    // each offset around the block end, then, the characters crossing the block end are also tested,
+    // including the surrogates and the overlong ones
+    static const unsigned char lastbytes[] = { 0x00, 0x09, 0x41, 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf,
+            0xc0, 0xc2, 0xdf, 0xe0, 0xed, 0xf0, 0xf4, 0xf5, 0xff };
+
+    std::vector<char> source( 64, 'a' );
+    for( unsigned int offset = 12; offset < 36 && !failures; ++offset ) {
+        for( unsigned int first = 0x80; first < 0x100; ++first ) {
+            for( unsigned int second = 0; second < 0x100; ++second ) {
+                for( unsigned char third : lastbytes ) {
+                    source[offset] = static_cast<char>( first );
+                    source[offset + 1] = static_cast<char>( second );
+                    source[offset + 2] = static_cast<char>( third );
+
+                    char expected[64];
+                    char destination[64];
+                    size_t expectedsize = fastfile_utf8only_scalar( expected, source.data(), source.size() );
+                    size_t destinationsize = utf8only( destination, source.data(), source.size() );
+
+                    if( destinationsize != expectedsize || memcmp( destination, expected, expectedsize ) != 0
+                        || utf8prefix( source.data(), source.size() ) != fastfile_utf8prefix_scalar( source.data(), source.size() ) )
+                    {
+                        std::cerr << "FAILED " << name << " offset " << offset << " bytes " << std::hex << first
+                                << " " << second << " " << static_cast<unsigned int>( third ) << std::dec << std::endl;
+                        ++failures;
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << ( failures ? "FAILED " : "OK     " ) << name << std::endl;
+    return failures;
+}
+
+// Compares the time to trim ASCII text and text with valid multibyte characters against the time
+// of fastfile_printableonly(), the FASTFILE_TRIMUFT8=1 filter
+void benchmark(const char* name, unsigned int density, const char* characters) {
+    std::vector<char> source( 64 * 1024 * 1024 );
+    std::mt19937 randomgenerator( 42 );
+    std::uniform_int_distribution<int> percentage( 0, 99 );
+
+    for( size_t index = 0; index < source.size(); ) {
+        const char* picked = static_cast<unsigned int>( percentage( randomgenerator ) ) < density ? characters : "e";
+
+        for( ; *picked && index < source.size(); ++picked, ++index ) {
+            source[index] = *picked;
+        }
+    }
+
+    std::vector<char> destination( source.size() );
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t printablesize = fastfile_printableonly( destination.data(), source.data(), source.size() );
+    std::chrono::duration<double> printabletime = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t utf8size = fastfile_utf8only( destination.data(), source.data(), source.size() );
+    std::chrono::duration<double> utf8time = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << name << " printableonly " << source.size() / printabletime.count() / 1e9 << " GB/s size "
+            << printablesize << " utf8only " << source.size() / utf8time.count() / 1e9 << " GB/s size "
+            << utf8size << std::endl;
+}
+
+// g++ -o main.exe utf8_filter_test.cpp -O2 --std=c++11 && ./main.exe
+int main(int argc, char const *argv[])
+{
+    int failures = 0;
+    failures += testimplementation( "selected", fastfile_utf8only_select(), fastfile_utf8prefix_select() );
+
+#if defined(FASTFILE_SIMD_AVX2)
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "ssse3" ) ) {
+        failures += testimplementation( "ssse3", fastfile_utf8only_ssse3, fastfile_utf8prefix_ssse3 );
+    }
+
+    if( __builtin_cpu_supports( "avx2" ) ) {
+        failures += testimplementation( "avx2", fastfile_utf8only_avx2, fastfile_utf8prefix_avx2 );
+    }
+#endif
+
+    benchmark( "ascii", 0, "" );
+    benchmark( "accents", 5, "\xc3\xa7\xc3\xa3" );
+    benchmark( "japanese", 100, "\xe6\x97\xa5\xe6\x9c\xac" );
+    benchmark( "controls", 1, "\t" );
+    return failures ? 1 : 0;
+}